@@ -0,0 +1,30 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "cube_state.hpp"
+
+// Microbenchmark of CubeState::apply(), usage: bench-moves [number of moves]
+
+int main(int argc, char** argv) {
+  const long n = argc > 1 ? std::atol(argv[1]) : 100'000'000;
+  std::vector<uint8_t> seq(4096);  // random moves, replayed until n moves have been applied
+  std::mt19937 rng(42);
+  for (uint8_t& m : seq) m = uint8_t(rng() % twophase::N_MOVE);
+
+  CubeState cube;
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < n; i++) cube.apply(seq[i & 4095]);
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::printf("%s: %ld moves in %.3f s, %.1f Mmoves/s, %.2f ns/move (checksum %d)\n",
+#if defined(__SSSE3__)
+              "ssse3",
+#else
+              "scalar",
+#endif
+              n, secs, n / secs / 1e6, secs * 1e9 / n, cube.corners[0] + cube.edges[0]);
+  return 0;
+}
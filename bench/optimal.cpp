@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "twophase/cubie.hpp"
+#include "twophase/face.hpp"
+#include "twophase/solver.hpp"
+
+// Benchmark of solve_optimal(): the time to find a shortest maneuver and to prove that there is no shorter one. Random
+// cubes take long with the tables of the optimal solver, so by default the cubes are random scrambles of a fixed
+// length. The same seed gives the same cubes on every machine.
+
+namespace {
+
+void usage() {
+  std::fprintf(stderr,
+               "usage: bench-optimal [options]\n"
+               "  -n N               number of cubes (default 10)\n"
+               "  -d, --depth N      length of the random scrambles, 0 for random cubes (default 14)\n"
+               "  -s, --seed S       seed of the cubes (default 1)\n"
+               "  -t, --timeout S    timeout of every solve in seconds (default 600)\n"
+               "  -T, --threads N    search threads (default: number of hardware threads)\n"
+               "  --json FILE        write the results as JSON, - for stdout\n");
+  std::exit(2);
+}
+
+struct Result {
+  int length;  // -1 if the search timed out
+  double seconds;
+  uint64_t nodes;
+};
+
+// Nearest rank percentile of sorted values.
+double percentile(const std::vector<double>& sorted, double p) {
+  if (sorted.empty()) return 0;
+  size_t rank = size_t(std::ceil(p / 100 * double(sorted.size())));
+  return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+std::vector<std::string> make_cubes(int n, int depth, unsigned long seed) {
+  std::mt19937_64 rng(seed);
+  std::vector<std::string> cubes(n);
+  for (std::string& s : cubes) {
+    twophase::CubieCube cc;
+    if (depth == 0) {
+      cc.randomize(rng);
+    } else {
+      int last = -1;
+      for (int i = 0; i < depth; i++) {
+        int m;
+        do m = int(rng() % twophase::N_MOVE);
+        while (last >= 0 && m / 3 == last / 3);  // no two moves of the same face in a row
+        cc.multiply(twophase::moveCube[m]);
+        last = m;
+      }
+    }
+    s = cc.to_facelet_cube().to_string();
+  }
+  return cubes;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int n = 10, depth = 14, threads = 0;
+  unsigned long seed = 1;
+  double timeout = 600;
+  const char* json = nullptr;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto value = [&] {
+      if (i + 1 >= argc) usage();
+      return argv[++i];
+    };
+    if (arg == "-n") n = std::atoi(value());
+    else if (arg == "-d" || arg == "--depth") depth = std::max(0, std::atoi(value()));
+    else if (arg == "-s" || arg == "--seed") seed = std::strtoul(value(), nullptr, 10);
+    else if (arg == "-t" || arg == "--timeout") timeout = std::atof(value());
+    else if (arg == "-T" || arg == "--threads") threads = std::atoi(value());
+    else if (arg == "--json") json = value();
+    else usage();
+  }
+  if (n < 1) usage();
+  if (threads > 0) twophase::set_threads(threads);
+  if (threads <= 0) threads = std::max(1, int(std::thread::hardware_concurrency()));
+
+  bool json_stdout = json && std::string(json) == "-";
+  FILE* out = json_stdout ? stderr : stdout;
+  auto start = std::chrono::steady_clock::now();
+  twophase::init_optimal();
+  double load = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::fprintf(out, "tables loaded in %.2f s\n", load);
+  std::fprintf(out, "%d cubes, %s, seed %lu, timeout %g s, %d threads\n", n,
+               depth ? ("scrambles of " + std::to_string(depth) + " moves").c_str() : "random cubes", seed, timeout,
+               threads);
+
+  std::vector<Result> results;
+  std::vector<double> times;
+  uint64_t nodes = 0;
+  for (const std::string& s : make_cubes(n, depth, seed)) {
+    twophase::SolveStats stats;
+    twophase::SolveHooks hooks;
+    hooks.stats = &stats;
+    auto t = std::chrono::steady_clock::now();
+    std::string sol = twophase::solve_optimal(s, timeout, hooks);
+    Result r{-1, std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count(), stats.optimal_nodes};
+    size_t paren = sol.rfind('(');
+    if (sol.rfind("Error", 0) != 0 && paren != std::string::npos) r.length = std::atoi(sol.c_str() + paren + 1);
+    std::fprintf(out, "%s %2d moves %9.3f s %14llu nodes\n", s.c_str(), r.length, r.seconds,
+                 (unsigned long long)r.nodes);
+    results.push_back(r);
+    times.push_back(r.seconds);
+    nodes += r.nodes;
+  }
+  std::sort(times.begin(), times.end());
+  double total = 0;
+  for (double t : times) total += t;
+  int timeouts = int(std::count_if(results.begin(), results.end(), [](const Result& r) { return r.length < 0; }));
+  std::fprintf(out, "time to prove optimality: p50 %.3f s, p95 %.3f s, max %.3f s, %.0f nodes/s, %d timeouts\n",
+               percentile(times, 50), percentile(times, 95), times.back(), double(nodes) / total, timeouts);
+
+  if (json) {
+    std::ostringstream js;
+    js << "{\n  \"engine\": \"optimal\",\n  \"hardware_threads\": " << std::thread::hardware_concurrency()
+       << ",\n  \"threads\": " << threads << ",\n  \"cubes\": " << n << ",\n  \"depth\": " << depth
+       << ",\n  \"seed\": " << seed << ",\n  \"timeout\": " << timeout << ",\n  \"table_load_seconds\": " << load
+       << ",\n  \"seconds\": {\"p50\": " << percentile(times, 50) << ", \"p95\": " << percentile(times, 95)
+       << ", \"max\": " << times.back() << ", \"total\": " << total << "},\n  \"nodes_per_second\": "
+       << double(nodes) / total << ",\n  \"timeouts\": " << timeouts << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++)
+      js << (i ? ", " : "") << "{\"length\": " << results[i].length << ", \"seconds\": " << results[i].seconds
+         << ", \"nodes\": " << results[i].nodes << "}";
+    js << "]\n}\n";
+    FILE* f = json_stdout ? stdout : std::fopen(json, "w");
+    if (!f) {
+      std::fprintf(stderr, "bench-optimal: cannot write %s\n", json);
+      return 1;
+    }
+    std::string text = js.str();
+    std::fwrite(text.data(), 1, text.size(), f);
+    if (f != stdout) std::fclose(f);
+  }
+  return 0;
+}
@@ -0,0 +1,193 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "server/protocol.hpp"
+
+// Round trip latency of a running cube-server, HTTP against the binary protocol of the Unix domain socket. A move is
+// answered with the new state in both: /move returns the cube definition string, the binary client sends the move and
+// STATE in one write and reads the 20 byte state.
+
+namespace {
+
+void usage() {
+  std::fprintf(stderr,
+               "usage: bench-protocol [options]\n"
+               "  -n N               round trips of every kind (default 10000)\n"
+               "  -p, --port N       HTTP port of the server (default 8081)\n"
+               "  -u, --unix PATH    Unix socket of the server (default %s)\n"
+               "  --json FILE        write the results as JSON, - for stdout\n",
+               proto::DEFAULT_PATH);
+  std::exit(2);
+}
+
+[[noreturn]] void fail(const std::string& what) {
+  std::fprintf(stderr, "bench-protocol: %s: %s\n", what.c_str(), std::strerror(errno));
+  std::exit(1);
+}
+
+int connect_tcp(int port) {
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(uint16_t(port));
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+    fail("cannot connect to port " + std::to_string(port));
+  int on = 1;
+  ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  return fd;
+}
+
+int connect_unix(const std::string& path) {
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+  if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) fail("cannot connect to " + path);
+  return fd;
+}
+
+void send_all(int fd, const std::string& s) {
+  for (size_t pos = 0; pos < s.size();) {
+    ssize_t n = ::send(fd, s.data() + pos, s.size() - pos, MSG_NOSIGNAL);
+    if (n <= 0) fail("send");
+    pos += size_t(n);
+  }
+}
+
+// Read until complete(buf) returns the length of a whole reply, which is removed from buf.
+void receive(int fd, std::string& buf, const std::function<size_t(const std::string&)>& complete) {
+  char data[4096];
+  size_t n;
+  while ((n = complete(buf)) == 0) {
+    ssize_t r = ::recv(fd, data, sizeof(data), 0);
+    if (r <= 0) fail("recv");
+    buf.append(data, size_t(r));
+  }
+  buf.erase(0, n);
+}
+
+// Length of the HTTP response at the start of buf, 0 if it is incomplete.
+size_t http_response_size(const std::string& buf) {
+  size_t end = buf.find("\r\n\r\n");
+  if (end == std::string::npos) return 0;
+  size_t cl = buf.find("Content-Length: ");
+  if (cl == std::string::npos || cl > end) return end + 4;
+  size_t size = end + 4 + std::strtoul(buf.c_str() + cl + 16, nullptr, 10);
+  return buf.size() < size ? 0 : size;
+}
+
+struct Result {
+  std::string name;
+  std::vector<double> micros;  // sorted
+
+  double percentile(double p) const {
+    size_t rank = size_t(std::ceil(p / 100 * double(micros.size())));
+    return micros[std::clamp<size_t>(rank, 1, micros.size()) - 1];
+  }
+  double mean() const {
+    double sum = 0;
+    for (double t : micros) sum += t;
+    return sum / double(micros.size());
+  }
+};
+
+Result measure(const std::string& name, int n, const std::function<void(int)>& round_trip) {
+  for (int i = 0; i < n / 10; i++) round_trip(i);  // warm up
+  Result r{name, {}};
+  for (int i = 0; i < n; i++) {
+    auto t = std::chrono::steady_clock::now();
+    round_trip(i);
+    r.micros.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t).count());
+  }
+  std::sort(r.micros.begin(), r.micros.end());
+  return r;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int n = 10000, port = 8081;
+  std::string path = proto::DEFAULT_PATH;
+  const char* json = nullptr;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto value = [&] {
+      if (i + 1 >= argc) usage();
+      return argv[++i];
+    };
+    if (arg == "-n") n = std::atoi(value());
+    else if (arg == "-p" || arg == "--port") port = std::atoi(value());
+    else if (arg == "-u" || arg == "--unix") path = value();
+    else if (arg == "--json") json = value();
+    else usage();
+  }
+  if (n < 1) usage();
+
+  static const char faces[] = "urfdlb";
+  const std::string session = "bench-" + std::to_string(::getpid());
+  int http_fd = connect_tcp(port), unix_fd = connect_unix(path);
+  std::string http_buf, unix_buf;
+  send_all(unix_fd, proto::session_request(session));
+
+  std::vector<Result> results;
+  results.push_back(measure("http move", n, [&](int i) {
+    send_all(http_fd,
+             "GET /move?session=" + session + "&move=" + faces[i % 6] + " HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    receive(http_fd, http_buf, http_response_size);
+  }));
+  results.push_back(measure("binary move", n, [&](int i) {
+    send_all(unix_fd, {char(3 * (i % 6)), char(proto::STATE)});
+    receive(unix_fd, unix_buf, [](const std::string& b) { return b.size() < proto::STATE_SIZE ? 0 : b.size(); });
+  }));
+  results.push_back(measure("http state", n, [&](int) {
+    send_all(http_fd, "GET /state?session=" + session + " HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    receive(http_fd, http_buf, http_response_size);
+  }));
+  results.push_back(measure("binary state", n, [&](int) {
+    send_all(unix_fd, {char(proto::FACELETS)});
+    receive(unix_fd, unix_buf, [](const std::string& b) { return b.size() < 54 ? 0 : b.size(); });
+  }));
+  ::close(http_fd);
+  ::close(unix_fd);
+
+  FILE* out = json && std::string(json) == "-" ? stderr : stdout;
+  std::fprintf(out, "%d round trips each, session %s\n", n, session.c_str());
+  for (const Result& r : results)
+    std::fprintf(out, "%-13s p50 %7.1f us  p99 %7.1f us  mean %7.1f us\n", r.name.c_str(), r.percentile(50),
+                 r.percentile(99), r.mean());
+
+  if (json) {
+    std::ostringstream js;
+    js << "{\n  \"round_trips\": " << n << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++)
+      js << (i ? ", " : "") << "{\"name\": \"" << results[i].name << "\", \"p50_us\": " << results[i].percentile(50)
+         << ", \"p99_us\": " << results[i].percentile(99) << ", \"mean_us\": " << results[i].mean() << "}";
+    js << "]\n}\n";
+    FILE* f = out == stderr ? stdout : std::fopen(json, "w");
+    if (!f) {
+      std::fprintf(stderr, "bench-protocol: cannot write %s\n", json);
+      return 1;
+    }
+    std::string text = js.str();
+    std::fwrite(text.data(), 1, text.size(), f);
+    if (f != stdout) std::fclose(f);
+  }
+  return 0;
+}
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "twophase/cubie.hpp"
+#include "twophase/face.hpp"
+#include "twophase/solver.hpp"
+
+// Solver benchmark, the C++ counterpart of test(n, t) in kociemba/performance.py. The same seed gives the same cubes
+// on every machine, so the JSON output of two builds can be compared.
+
+namespace {
+
+void usage() {
+  std::fprintf(stderr,
+               "usage: bench-solve [options]\n"
+               "  -n N               number of random cubes (default 100)\n"
+               "  -s, --seed S       seed of the random cubes (default 1)\n"
+               "  -l, --max-length N max_length of solve() (default 20)\n"
+               "  -t, --timeout S    timeout of solve() in seconds (default 1)\n"
+               "  -T, --threads LIST solver threads to sweep, e.g. 1,2,4 (default 1, 2, 4, ... up to the number of\n"
+               "                     hardware threads)\n"
+               "  --json FILE        write the results as JSON, - for stdout\n");
+  std::exit(2);
+}
+
+struct Run {
+  int threads;
+  double seconds;  // wall time of all solves
+  std::vector<double> latencies;  // seconds, sorted
+  std::vector<int> histogram;  // number of solutions by length
+  int errors = 0;
+  uint64_t phase1_nodes, phase2_nodes;
+
+  // Nearest rank percentile.
+  double percentile(double p) const {
+    if (latencies.empty()) return 0;
+    size_t rank = size_t(std::ceil(p / 100 * double(latencies.size())));
+    return latencies[std::clamp<size_t>(rank, 1, latencies.size()) - 1];
+  }
+  double per_core() const { return double(latencies.size()) / seconds / threads; }
+  double average_length() const {
+    int n = 0, sum = 0;
+    for (int len = 0; len < int(histogram.size()); len++) {
+      n += histogram[len];
+      sum += len * histogram[len];
+    }
+    return n ? double(sum) / n : 0;
+  }
+};
+
+Run run(const std::vector<std::string>& cubes, int threads, int max_length, double timeout) {
+  twophase::set_threads(threads);
+  twophase::SolveStats stats;
+  twophase::SolveHooks hooks;
+  hooks.stats = &stats;
+  Run r{threads, 0, {}, std::vector<int>(31), 0, 0, 0};
+  auto start = std::chrono::steady_clock::now();
+  for (const std::string& s : cubes) {
+    auto t = std::chrono::steady_clock::now();
+    std::string sol = twophase::solve(s, max_length, timeout, hooks);
+    r.latencies.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count());
+    size_t paren = sol.rfind('(');
+    if (sol.rfind("Error", 0) == 0 || paren == std::string::npos) r.errors++;
+    else r.histogram[std::min(std::atoi(sol.c_str() + paren + 1), 30)]++;
+  }
+  r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::sort(r.latencies.begin(), r.latencies.end());
+  r.phase1_nodes = stats.phase1_nodes;
+  r.phase2_nodes = stats.phase2_nodes;
+  return r;
+}
+
+void report(FILE* out, const Run& r) {
+  std::fprintf(out, "threads %d: %.2f s, p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, %.2f solutions/s/core\n", r.threads,
+               r.seconds, 1e3 * r.percentile(50), 1e3 * r.percentile(95), 1e3 * r.percentile(99), r.per_core());
+  std::fprintf(out, "  average %.2f moves, {", r.average_length());
+  bool first = true;
+  for (int len = 0; len < int(r.histogram.size()); len++) {
+    if (!r.histogram[len]) continue;
+    std::fprintf(out, "%s%d: %d", first ? "" : ", ", len, r.histogram[len]);
+    first = false;
+  }
+  std::fprintf(out, "}%s\n", r.errors ? (", " + std::to_string(r.errors) + " errors").c_str() : "");
+  std::fprintf(out, "  nodes phase 1 %llu, phase 2 %llu\n", (unsigned long long)r.phase1_nodes,
+               (unsigned long long)r.phase2_nodes);
+}
+
+std::string to_json(const std::vector<Run>& runs, int n, unsigned long seed, int max_length, double timeout) {
+  std::ostringstream js;
+  js << "{\n  \"engine\": \"twophase\",\n  \"simd\": \""
+#if defined(__SSSE3__)
+     << "ssse3"
+#else
+     << "scalar"
+#endif
+     << "\",\n  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n  \"cubes\": " << n
+     << ",\n  \"seed\": " << seed << ",\n  \"max_length\": " << max_length << ",\n  \"timeout\": " << timeout
+     << ",\n  \"runs\": [";
+  for (size_t i = 0; i < runs.size(); i++) {
+    const Run& r = runs[i];
+    js << (i ? "," : "") << "\n    {\"threads\": " << r.threads << ", \"seconds\": " << r.seconds
+       << ", \"latency_ms\": {\"p50\": " << 1e3 * r.percentile(50) << ", \"p95\": " << 1e3 * r.percentile(95)
+       << ", \"p99\": " << 1e3 * r.percentile(99) << ", \"max\": " << 1e3 * r.latencies.back()
+       << "}, \"solutions_per_second_per_core\": " << r.per_core() << ", \"average_length\": " << r.average_length()
+       << ", \"errors\": " << r.errors << ", \"histogram\": {";
+    bool first = true;
+    for (int len = 0; len < int(r.histogram.size()); len++) {
+      if (!r.histogram[len]) continue;
+      js << (first ? "" : ", ") << "\"" << len << "\": " << r.histogram[len];
+      first = false;
+    }
+    js << "}, \"phase1_nodes\": " << r.phase1_nodes << ", \"phase2_nodes\": " << r.phase2_nodes << "}";
+  }
+  js << "\n  ]\n}\n";
+  return js.str();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int n = 100, max_length = 20;
+  unsigned long seed = 1;
+  double timeout = 1;
+  std::vector<int> threads;
+  const char* json = nullptr;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto value = [&] {
+      if (i + 1 >= argc) usage();
+      return argv[++i];
+    };
+    if (arg == "-n") n = std::atoi(value());
+    else if (arg == "-s" || arg == "--seed") seed = std::strtoul(value(), nullptr, 10);
+    else if (arg == "-l" || arg == "--max-length") max_length = std::atoi(value());
+    else if (arg == "-t" || arg == "--timeout") timeout = std::atof(value());
+    else if (arg == "-T" || arg == "--threads") {
+      std::istringstream list(value());
+      for (std::string t; std::getline(list, t, ',');) threads.push_back(std::max(1, std::atoi(t.c_str())));
+    } else if (arg == "--json") json = value();
+    else usage();
+  }
+  if (n < 1) usage();
+  if (threads.empty()) {
+    int hw = std::max(1, int(std::thread::hardware_concurrency()));
+    for (int t = 1; t < hw; t *= 2) threads.push_back(t);
+    threads.push_back(hw);
+  }
+
+  std::mt19937_64 rng(seed);
+  std::vector<std::string> cubes(n);
+  for (std::string& s : cubes) {
+    twophase::CubieCube cc;
+    cc.randomize(rng);
+    s = cc.to_facelet_cube().to_string();
+  }
+
+  bool json_stdout = json && std::string(json) == "-";
+  FILE* out = json_stdout ? stderr : stdout;
+  twophase::init();  // the table creation is not part of the benchmark
+  std::fprintf(out, "%d cubes, seed %lu, max_length %d, timeout %g s\n", n, seed, max_length, timeout);
+  std::vector<Run> runs;
+  for (int t : threads) {
+    runs.push_back(run(cubes, t, max_length, timeout));
+    report(out, runs.back());
+  }
+
+  if (json) {
+    std::string js = to_json(runs, n, seed, max_length, timeout);
+    FILE* f = json_stdout ? stdout : std::fopen(json, "w");
+    if (!f) {
+      std::fprintf(stderr, "bench-solve: cannot write %s\n", json);
+      return 1;
+    }
+    std::fwrite(js.data(), 1, js.size(), f);
+    if (f != stdout) std::fclose(f);
+  }
+  return 0;
+}
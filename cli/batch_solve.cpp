@@ -0,0 +1,122 @@
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "twophase/solver.hpp"
+
+// Solve cube definition strings in batch, one per line from a file or stdin. The results are written to stdout in
+// input order, one line per input line, as soon as all earlier lines have been solved.
+
+namespace {
+
+void usage() {
+  std::fprintf(stderr,
+               "usage: batch-solve [options] [file]\n"
+               "  -l, --max-length N  stop searching when a solution with at most N moves is found (default 20)\n"
+               "  -t, --timeout S     return the best solution after S seconds per cube (default 3)\n"
+               "  -d, --deadline S    stop after S seconds per cube even without a solution (default: none)\n"
+               "  -j, --jobs N        cubes solved at the same time (default: number of hardware threads)\n");
+  std::exit(2);
+}
+
+// Lines between the reader, the solving threads and the writer. At most WINDOW lines are in flight, so the memory
+// stays bounded for any input size.
+struct Pipeline {
+  static constexpr long WINDOW = 4096;
+  std::mutex lock;
+  std::condition_variable changed;
+  std::deque<std::pair<long, std::string>> input;  // read, not yet taken by a solving thread
+  std::map<long, std::string> done;  // solved, waiting for earlier lines
+  long read = 0, written = 0;
+  bool eof = false;
+};
+
+void solve_lines(Pipeline& pl, int max_length, double timeout, double deadline) {
+  twophase::SolveHooks hooks;
+  hooks.deadline = deadline;
+  std::unique_lock lock(pl.lock);
+  while (true) {
+    pl.changed.wait(lock, [&] { return !pl.input.empty() || pl.eof; });
+    if (pl.input.empty()) return;
+    auto [idx, line] = std::move(pl.input.front());
+    pl.input.pop_front();
+    lock.unlock();
+    std::string result = twophase::solve(line, max_length, timeout, hooks);
+    lock.lock();
+    pl.done.emplace(idx, std::move(result));
+    bool progress = false;
+    for (auto it = pl.done.begin(); it != pl.done.end() && it->first == pl.written; it = pl.done.erase(it)) {
+      std::fwrite(it->second.data(), 1, it->second.size(), stdout);
+      std::fputc('\n', stdout);
+      pl.written++;
+      progress = true;
+    }
+    if (progress) {
+      std::fflush(stdout);
+      pl.changed.notify_all();  // the reader may continue
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int max_length = 20;
+  double timeout = 3, deadline = 0;
+  int jobs = int(std::thread::hardware_concurrency());
+  const char* file = nullptr;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto value = [&] {
+      if (i + 1 >= argc) usage();
+      return argv[++i];
+    };
+    if (arg == "-l" || arg == "--max-length") max_length = std::atoi(value());
+    else if (arg == "-t" || arg == "--timeout") timeout = std::atof(value());
+    else if (arg == "-d" || arg == "--deadline") deadline = std::atof(value());
+    else if (arg == "-j" || arg == "--jobs") jobs = std::atoi(value());
+    else if (arg == "-h" || arg == "--help" || (arg[0] == '-' && arg != "-") || file) usage();
+    else file = argv[i];
+  }
+  if (jobs < 1) jobs = 1;
+
+  std::ifstream fin;
+  if (file && std::strcmp(file, "-") != 0) {
+    fin.open(file);
+    if (!fin) {
+      std::fprintf(stderr, "batch-solve: cannot open %s\n", file);
+      return 1;
+    }
+  }
+  std::istream& in = fin.is_open() ? fin : std::cin;
+
+  twophase::init();  // load the tables before the first cube is timed
+  Pipeline pl;
+  std::vector<std::thread> solvers;
+  for (int i = 0; i < jobs; i++) solvers.emplace_back(solve_lines, std::ref(pl), max_length, timeout, deadline);
+
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    std::unique_lock lock(pl.lock);
+    pl.changed.wait(lock, [&] { return pl.read - pl.written < Pipeline::WINDOW; });
+    pl.input.emplace_back(pl.read++, std::move(line));
+    pl.changed.notify_all();
+  }
+  {
+    std::lock_guard guard(pl.lock);
+    pl.eof = true;
+  }
+  pl.changed.notify_all();
+  for (auto& t : solvers) t.join();
+  return 0;
+}
@@ -0,0 +1,23 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "twophase/defs.hpp"
+#include "twophase/solver.hpp"
+
+// Create all tables in precomputed/ of the working directory, e.g. when deploying to a new machine. Valid tables are
+// kept, delete a table file to create it again. With --optimal the large table of solve_optimal() is created as well.
+
+int main(int argc, char** argv) {
+  bool optimal = argc > 1 && std::string(argv[1]) == "--optimal";
+  if (argc > 2 || (argc == 2 && !optimal)) {
+    std::fprintf(stderr, "usage: make-tables [--optimal]\n");
+    return 2;
+  }
+  auto start = std::chrono::steady_clock::now();
+  twophase::init();
+  if (optimal) twophase::init_optimal();
+  std::printf("tables in %s/ ready after %.1f s\n", twophase::FOLDER,
+              std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  return 0;
+}
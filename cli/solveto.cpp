@@ -0,0 +1,101 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "twophase/solver.hpp"
+
+// Solve cubes to goal positions instead of the solved cube, e.g. to find pattern scrambles. Every input line holds a
+// start and a goal cube definition string, or with -g only a start which is solved to every goal of the goal file. The
+// results are written to stdout as soon as they are found, one line per pair in input order: for every start all goals
+// with -g. The same start or goal on several lines is checked and inverted once, see twophase::solveto_batch().
+
+namespace {
+
+void usage() {
+  std::fprintf(stderr,
+               "usage: solveto [options] [file]\n"
+               "  -g, --goals FILE    solve every start of the input to every goal of FILE, one per line\n"
+               "  -l, --max-length N  stop searching when a solution with at most N moves is found (default 20)\n"
+               "  -t, --timeout S     return the best solution after S seconds per pair (default 3)\n"
+               "  -d, --deadline S    stop after S seconds per pair even without a solution (default: none)\n");
+  std::exit(2);
+}
+
+// Index of s in strings, added if it is new.
+int intern(const std::string& s, std::vector<std::string>& strings, std::map<std::string, int>& index) {
+  auto [it, added] = index.emplace(s, int(strings.size()));
+  if (added) strings.push_back(s);
+  return it->second;
+}
+
+bool open(const char* file, std::ifstream& in) {
+  in.open(file);
+  if (!in) std::fprintf(stderr, "solveto: cannot open %s\n", file);
+  return bool(in);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int max_length = 20;
+  double timeout = 3, deadline = 0;
+  const char* file = nullptr;
+  const char* goal_file = nullptr;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto value = [&] {
+      if (i + 1 >= argc) usage();
+      return argv[++i];
+    };
+    if (arg == "-g" || arg == "--goals") goal_file = value();
+    else if (arg == "-l" || arg == "--max-length") max_length = std::atoi(value());
+    else if (arg == "-t" || arg == "--timeout") timeout = std::atof(value());
+    else if (arg == "-d" || arg == "--deadline") deadline = std::atof(value());
+    else if (arg == "-h" || arg == "--help" || (arg[0] == '-' && arg != "-") || file) usage();
+    else file = argv[i];
+  }
+
+  std::ifstream fin, gin;
+  if (file && std::strcmp(file, "-") != 0 && !open(file, fin)) return 1;
+  if (goal_file && !open(goal_file, gin)) return 1;
+  std::istream& in = fin.is_open() ? fin : std::cin;
+
+  std::vector<std::string> starts, goals;
+  std::map<std::string, int> start_index, goal_index;
+  std::vector<int> goal_lines;  // -g: the goals in the order of the file
+  std::string line;
+  while (goal_file && std::getline(gin, line)) {
+    std::istringstream words(line);
+    std::string goal;
+    if (words >> goal) goal_lines.push_back(intern(goal, goals, goal_index));
+  }
+  std::vector<twophase::SolvetoPair> pairs;
+  while (std::getline(in, line)) {
+    std::istringstream words(line);
+    std::string start, goal;
+    if (!(words >> start)) continue;
+    int s = intern(start, starts, start_index);
+    if (goal_file) {
+      for (int g : goal_lines) pairs.push_back({s, g});
+    } else {
+      words >> goal;  // a missing goal is reported as an invalid second cube
+      pairs.push_back({s, intern(goal, goals, goal_index)});
+    }
+  }
+
+  twophase::init();
+  twophase::SolveHooks hooks;
+  hooks.deadline = deadline;
+  twophase::solveto_batch(starts, goals, pairs, max_length, timeout, [](size_t, const std::string& result) {
+    std::fwrite(result.data(), 1, result.size(), stdout);
+    std::fputc('\n', stdout);
+    std::fflush(stdout);
+  }, hooks);
+  return 0;
+}
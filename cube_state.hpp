@@ -0,0 +1,133 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+#include "twophase/cubie.hpp"
+
+// Packed cube state of the client. The 8 corners and 12 edges are stored as one byte per cubie in two 16 byte
+// vectors, a move is a byte shuffle plus an orientation update, done with SSSE3 if the compiler may use it.
+
+// Byte of a corner: piece + 8 * orientation, byte of an edge: piece + 16 * orientation. Lanes past the last cubie
+// are never moved.
+struct CubeMove {
+  alignas(16) uint8_t cp[16];  // new cubie i comes from position cp[i]
+  alignas(16) uint8_t co[16];  // added to the corner byte, 8 * twist
+  alignas(16) uint8_t ep[16];
+  alignas(16) uint8_t eo[16];  // xored into the edge byte, 16 * flip
+};
+
+// The 18 moves in the order of twophase::Move: U1 U2 U3 R1 ... B3.
+inline constexpr std::array<CubeMove, twophase::N_MOVE> cubeMoves = [] {
+  std::array<CubeMove, twophase::N_MOVE> ret{};
+  for (int m = 0; m < twophase::N_MOVE; m++) {
+    const twophase::CubieCube& mc = twophase::moveCube[m];
+    for (int i = 0; i < 16; i++) {
+      ret[m].cp[i] = uint8_t(i < 8 ? mc.cp[i] : i);
+      ret[m].co[i] = uint8_t(i < 8 ? 8 * mc.co[i] : 0);
+      ret[m].ep[i] = uint8_t(i < 12 ? mc.ep[i] : i);
+      ret[m].eo[i] = uint8_t(i < 12 ? 16 * mc.eo[i] : 0);
+    }
+  }
+  return ret;
+}();
+
+struct CubeState {
+  alignas(16) std::array<uint8_t, 16> corners = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+  alignas(16) std::array<uint8_t, 16> edges = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+
+  // Apply one of the 18 moves, m is a twophase::Move.
+  void apply(int m) {
+    const CubeMove& mv = cubeMoves[m];
+#if defined(__SSSE3__)
+    __m128i c = _mm_load_si128(reinterpret_cast<const __m128i*>(corners.data()));
+    __m128i e = _mm_load_si128(reinterpret_cast<const __m128i*>(edges.data()));
+    c = _mm_add_epi8(_mm_shuffle_epi8(c, _mm_load_si128(reinterpret_cast<const __m128i*>(mv.cp))),
+                     _mm_load_si128(reinterpret_cast<const __m128i*>(mv.co)));
+    c = _mm_min_epu8(c, _mm_sub_epi8(c, _mm_set1_epi8(24)));  // twist mod 3, below 24 the subtraction wraps around
+    e = _mm_xor_si128(_mm_shuffle_epi8(e, _mm_load_si128(reinterpret_cast<const __m128i*>(mv.ep))),
+                      _mm_load_si128(reinterpret_cast<const __m128i*>(mv.eo)));
+    _mm_store_si128(reinterpret_cast<__m128i*>(corners.data()), c);
+    _mm_store_si128(reinterpret_cast<__m128i*>(edges.data()), e);
+#else
+    std::array<uint8_t, 16> c, e;
+    for (int i = 0; i < 8; i++) {
+      int x = corners[mv.cp[i]] + mv.co[i];
+      c[i] = uint8_t(x >= 24 ? x - 24 : x);
+    }
+    for (int i = 0; i < 12; i++) e[i] = edges[mv.ep[i]] ^ mv.eo[i];
+    for (int i = 8; i < 16; i++) c[i] = uint8_t(i);
+    for (int i = 12; i < 16; i++) e[i] = uint8_t(i);
+    corners = c;
+    edges = e;
+#endif
+  }
+
+  bool solved() const { return *this == CubeState(); }
+  bool operator==(const CubeState&) const = default;
+
+  twophase::CubieCube to_cubie_cube() const {
+    twophase::CubieCube cc;
+    for (int i = 0; i < 8; i++) {
+      cc.cp[i] = corners[i] & 7;
+      cc.co[i] = corners[i] >> 3;
+    }
+    for (int i = 0; i < 12; i++) {
+      cc.ep[i] = edges[i] & 15;
+      cc.eo[i] = edges[i] >> 4;
+    }
+    return cc;
+  }
+
+  // The 54 facelet colors in the order of twophase::Fc, U1..U9 R1..R9 F1..F9 D1..D9 L1..L9 B1..B9.
+  std::array<uint8_t, 54> facelets() const {
+    std::array<uint8_t, 54> f;
+    for (int c = 0; c < 6; c++) f[9 * c + 4] = uint8_t(c);  // centers
+    for (int i = 0; i < 8; i++) {
+      int j = corners[i] & 7, ori = corners[i] >> 3;
+      for (int k = 0; k < 3; k++) f[twophase::cornerFacelet[i][(k + ori) % 3]] = twophase::cornerColor[j][k];
+    }
+    for (int i = 0; i < 12; i++) {
+      int j = edges[i] & 15, ori = edges[i] >> 4;
+      for (int k = 0; k < 2; k++) f[twophase::edgeFacelet[i][(k + ori) % 2]] = twophase::edgeColor[j][k];
+    }
+    return f;
+  }
+
+  // Cube definition string as expected by twophase::solve().
+  std::string to_string() const {
+    static constexpr char colors[] = "URFDLB";
+    std::string s(54, ' ');
+    std::array<uint8_t, 54> f = facelets();
+    for (int i = 0; i < 54; i++) s[i] = colors[f[i]];
+    return s;
+  }
+};
+
+// Parse a move sequence into twophase::Move values. Accepts "U R' F2" as well as the solver output "U1 R3 F2 (3f)".
+// Returns false on an unknown token.
+inline bool parse_moves(const std::string& s, std::vector<int>& moves) {
+  static const std::string faces = "URFDLB";
+  std::istringstream in(s);
+  std::string tok;
+  moves.clear();
+  while (in >> tok) {
+    if (tok[0] == '(') break;  // length of a solver result
+    size_t face = faces.find(tok[0]);
+    if (face == std::string::npos || tok.size() > 2) return false;
+    int power = 0;  // quarter turn
+    if (tok.size() == 2) {
+      if (tok[1] == '2') power = 1;
+      else if (tok[1] == '3' || tok[1] == '\'') power = 2;
+      else if (tok[1] != '1') return false;
+    }
+    moves.push_back(3 * int(face) + power);
+  }
+  return true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Timings and counters of the frames drawn by the client, shown by the overlay of main.cpp and written to a CSV file
+// on exit. A frame is one call of display(): the time since the previous frame, the time inside display(), the draw
+// calls and vertices of the cube and the speed meter, and the time the GLUT thread was blocked reporting moves since
+// the previous frame.
+class FrameProfiler {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Frame {
+    double frameMs;  // since the start of the previous frame, 0 if the client was idle before
+    double displayMs;
+    int drawCalls, vertices;
+    double networkMs;
+  };
+
+  static constexpr size_t GRAPH_FRAMES = 240;  // the rolling graph and the percentiles
+  static constexpr size_t MAX_FRAMES = 1 << 17;  // kept for the CSV file, about half an hour at 60 frames per second
+
+  void beginFrame() {
+    Clock::time_point now = Clock::now();
+    double sincePrevious = std::chrono::duration<double, std::milli>(now - frameStart).count();
+    current = {frameStart == Clock::time_point() || sincePrevious > IDLE_MS ? 0 : sincePrevious, 0, 0, 0, networkMs};
+    networkMs = 0;
+    frameStart = now;
+  }
+
+  void endFrame() {
+    current.displayMs = std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count();
+    history.push_back(current);
+    if (history.size() > MAX_FRAMES) history.pop_front();
+  }
+
+  void draw(int vertices) {
+    current.drawCalls++;
+    current.vertices += vertices;
+  }
+
+  void blocked(Clock::duration d) { networkMs += std::chrono::duration<double, std::milli>(d).count(); }
+
+  const std::deque<Frame> &frames() const { return history; }
+
+  // Nearest rank percentile of the frame times of the last GRAPH_FRAMES frames, frames after an idle time excluded.
+  double percentile(double p) const {
+    std::vector<double> ms;
+    for (size_t i = history.size() > GRAPH_FRAMES ? history.size() - GRAPH_FRAMES : 0; i < history.size(); i++)
+      if (history[i].frameMs > 0) ms.push_back(history[i].frameMs);
+    if (ms.empty()) return 0;
+    std::sort(ms.begin(), ms.end());
+    size_t rank = size_t(std::ceil(p / 100 * double(ms.size())));
+    return ms[std::clamp<size_t>(rank, 1, ms.size()) - 1];
+  }
+
+  bool writeCsv(const std::string &path) const {
+    FILE *f = fopen(path.c_str(), "w");
+    if (!f) return false;
+    fprintf(f, "frame,frame_ms,display_ms,draw_calls,vertices,network_ms\n");
+    for (size_t i = 0; i < history.size(); i++) {
+      const Frame &fr = history[i];
+      fprintf(f, "%zu,%.3f,%.3f,%d,%d,%.3f\n", i, fr.frameMs, fr.displayMs, fr.drawCalls, fr.vertices, fr.networkMs);
+    }
+    return fclose(f) == 0;
+  }
+
+private:
+  static constexpr double IDLE_MS = 250;  // a longer gap is no frame time but a pause without redraws
+
+  std::deque<Frame> history;
+  Frame current{};
+  Clock::time_point frameStart;
+  double networkMs = 0;  // blocked since the start of the current frame
+};
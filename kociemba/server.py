@@ -8,6 +8,9 @@ from solver import solve
 
 
 class RubikServer(BaseHTTPRequestHandler):
+    # Keep the connection open, the client reports its moves over one persistent session
+    protocol_version = "HTTP/1.1"
+
     # Global cube state
     cube = cubie.CubieCube()
 
@@ -26,52 +29,46 @@ class RubikServer(BaseHTTPRequestHandler):
         elif path == "/solve":
             self.handle_solve()
         else:
-            self.send_response(404)
-            self.end_headers()
-            self.wfile.write(b"Not Found")
+            self.reply(404, b"Not Found")
+
+    def reply(self, code, body):
+        self.send_response(code)
+        self.send_header("Content-type", "text/plain")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
 
     def handle_move(self, query):
         if "move" not in query:
-            self.send_response(400)
-            self.end_headers()
-            self.wfile.write(b"Missing move parameter")
+            self.reply(400, b"Missing move parameter")
             return
 
-        move = query["move"][0].lower()
+        # One or more moves, the client batches the moves which piled up: move=urf
+        moves = query["move"][0].lower()
 
         # Map move to face index
         move_map = {"u": 0, "r": 1, "f": 2, "d": 3, "l": 4, "b": 5}
 
-        if move not in move_map:
-            self.send_response(400)
-            self.end_headers()
-            self.wfile.write(b"Invalid move")
+        if not moves or any(move not in move_map for move in moves):
+            self.reply(400, b"Invalid move")
             return
 
-        # Apply the move
-        self.cube.multiply(self.basicMoveCube[move_map[move]])
+        # Apply the moves in order
+        for move in moves:
+            self.cube.multiply(self.basicMoveCube[move_map[move]])
 
         # Return current state
-        self.send_response(200)
-        self.send_header("Content-type", "text/plain")
-        self.end_headers()
-        self.wfile.write(self.cube.to_facelet_cube().to_string().encode())
+        self.reply(200, self.cube.to_facelet_cube().to_string().encode())
 
     def handle_state(self):
-        self.send_response(200)
-        self.send_header("Content-type", "text/plain")
-        self.end_headers()
-        self.wfile.write(self.cube.to_facelet_cube().to_string().encode())
+        self.reply(200, self.cube.to_facelet_cube().to_string().encode())
 
     def handle_solve(self):
         # Convert to facelet cube
         fc = self.cube.to_facelet_cube()
         solution = solve(self.cube.to_facelet_cube().to_string(), 25, 1)
 
-        self.send_response(200)
-        self.send_header("Content-type", "text/plain")
-        self.end_headers()
-        self.wfile.write(solution.encode())
+        self.reply(200, solution.encode())
 
 
 def run(server_class=HTTPServer, handler_class=RubikServer, port=8080):
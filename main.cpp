@@ -1,13 +1,23 @@
 #include "utils.hpp"
+#include "cube_state.hpp"
+#include "frame_profiler.hpp"
 
+#define GL_GLEXT_PROTOTYPES  // buffer objects and glMultiDrawArrays are exported by libGL on Linux
 #include <GL/gl.h>
 #include <GL/glu.h>
 #include <GL/glut.h>
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <iostream>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <deque>
 #include <string>
+#include <thread>
+#include <vector>
 
 void *font = GLUT_BITMAP_HELVETICA_18;
 
@@ -22,121 +32,35 @@ void output(int x, int y, const char *string) {
 
 static float speed = 1.75;
 
-static int top[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}}, right[3][3] = {{1, 1, 1}, {1, 1, 1}, {1, 1, 1}},
-           front[3][3] = {{2, 2, 2}, {2, 2, 2}, {2, 2, 2}}, back[3][3] = {{3, 3, 3}, {3, 3, 3}, {3, 3, 3}},
-           bottom[3][3] = {{4, 4, 4}, {4, 4, 4}, {4, 4, 4}}, left[3][3] = {{5, 5, 5}, {5, 5, 5}, {5, 5, 5}}, temp[3][3];
+// The cube as shown, facelets is refreshed whenever a move has been applied to cube.
+static CubeState cube;
+static std::array<uint8_t, 54> facelets = cube.facelets();
+static std::deque<int> moveQueue;  // twophase::Move values not yet shown
+static CubeState queuedCube;  // cube after all queued moves, what the solver works on
+
+// Faces in the facelet order of CubeState.
+enum Face { TOP, RIGHT, FRONT, BOTTOM, LEFT, BACK };
+static const int faceColor[6] = {0, 1, 2, 4, 5, 3};  // facelet color -> index in color[]
+// Rotation code 1..6 of the kociemba faces U R F D L B.
+static const int faceRotation[6] = {1, 2, 3, 6, 4, 5};
 
-int solve[10'000];
-int count = 0;
-int solve1 = 0;
 static int rotation = 0;
-int rotationcomplete = 0;
+int rotationcomplete = 1;
 static GLfloat theta = 0.0;
-static GLint axis = 0;
 static GLfloat p = 0.0, q = 0.0, r = 0.0;
 static GLint inverse = 0;
-static GLfloat angle = 0.0;
+static GLint halfturn = 0;  // the turn goes to 180 degrees
+static int turnMove = -1;  // twophase::Move being animated
 int beginx = 0, beginy = 0;
 int moving = 0;
-static int speedmetercolor[15] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-static int speedmetercount = -1;
-
-GLfloat vertices[][3] = {
-    {-1.0, -1.0, -1.0},
-
-    {1.0, -1.0, -1.0},  {1.0, 1.0, -1.0},   {-1.0, 1.0, -1.0},  //center
-    {-1.0, -1.0, 1.0},  {1.0, -1.0, 1.0},   {1.0, 1.0, 1.0},    {-1.0, 1.0, 1.0},
-
-    {-1.0, -3.0, -1.0}, {1.0, -3.0, -1.0},  {1.0, -1.0, -1.0},  {-1.0, -1.0, -1.0},  //bottom center
-    {-1.0, -3.0, 1.0},  {1.0, -3.0, 1.0},   {1.0, -1.0, 1.0},   {-1.0, -1.0, 1.0},
-
-    {-3.0, -1.0, -1.0}, {-1.0, -1.0, -1.0}, {-1.0, 1.0, -1.0},  {-3.0, 1.0, -1.0},  //left center
-    {-3.0, -1.0, 1.0},  {-1.0, -1.0, 1.0},  {-1.0, 1.0, 1.0},   {-3.0, 1.0, 1.0},
-
-    {1.0, -1.0, -1.0},  {3.0, -1.0, -1.0},  {3.0, 1.0, -1.0},   {1.0, 1.0, -1.0},  // right center
-    {1.0, -1.0, 1.0},   {3.0, -1.0, 1.0},   {3.0, 1.0, 1.0},    {1.0, 1.0, 1.0},
-
-    {-1.0, 1.0, -1.0},  {1.0, 1.0, -1.0},   {1.0, 3.0, -1.0},   {-1.0, 3.0, -1.0},  // top center
-    {-1.0, 1.0, 1.0},   {1.0, 1.0, 1.0},    {1.0, 3.0, 1.0},    {-1.0, 3.0, 1.0},
-
-    {-1.0, -1.0, 1.0},  {1.0, -1.0, 1.0},   {1.0, 1.0, 1.0},    {-1.0, 1.0, 1.0},  //front center
-
-    {-1.0, -1.0, 3.0},  {1.0, -1.0, 3.0},   {1.0, 1.0, 3.0},    {-1.0, 1.0, 3.0},
-
-    {-1.0, -1.0, -3.0}, {1.0, -1.0, -3.0},  {1.0, 1.0, -3.0},   {-1.0, 1.0, -3.0},  //back center
-    {-1.0, -1.0, -1.0}, {1.0, -1.0, -1.0},  {1.0, 1.0, -1.0},   {-1.0, 1.0, -1.0},
-
-    {-3.0, 1.0, -1.0},  {-1.0, 1.0, -1.0},  {-1.0, 3.0, -1.0},  {-3.0, 3.0, -1.0},  // top left center
-    {-3.0, 1.0, 1.0},   {-1.0, 1.0, 1.0},   {-1.0, 3.0, 1.0},   {-3.0, 3.0, 1.0},
-
-    {1.0, 1.0, -1.0},   {3.0, 1.0, -1.0},
-
-    {3.0, 3.0, -1.0},   {1.0, 3.0, -1.0},  // top right  center
-    {1.0, 1.0, 1.0},    {3.0, 1.0, 1.0},    {3.0, 3.0, 1.0},    {1.0, 3.0, 1.0},
-
-    {-1.0, 1.0, 1.0},   {1.0, 1.0, 1.0},    {1.0, 3.0, 1.0},    {-1.0, 3.0, 1.0},  // top front center
-    {-1.0, 1.0, 3.0},   {1.0, 1.0, 3.0},    {1.0, 3.0, 3.0},    {-1.0, 3.0, 3.0},
-
-    {-1.0, 1.0, -3.0},  {1.0, 1.0, -3.0},   {1.0, 3.0, -3.0},   {-1.0, 3.0, -3.0},  // top back center
-    {-1.0, 1.0, -1.0},  {1.0, 1.0, -1.0},   {1.0, 3.0, -1.0},   {-1.0, 3.0, -1.0},
-
-    {-3.0, -3.0, -1.0}, {-1.0, -3.0, -1.0}, {-1.0, -1.0, -1.0}, {-3.0, -1.0, -1.0},  //bottom left center
-    {-3.0, -3.0, 1.0},  {-1.0, -3.0, 1.0},  {-1.0, -1.0, 1.0},  {-3.0, -1.0, 1.0},
-
-    {1.0, -3.0, -1.0},  {3.0, -3.0, -1.0},  {3.0, -1.0, -1.0},  {1.0, -1.0, -1.0},  //bottom  right center
-    {1.0, -3.0, 1.0},   {3.0, -3.0, 1.0},   {3.0, -1.0, 1.0},   {1.0, -1.0, 1.0},
-
-    {-1.0, -3.0, 1.0},  {1.0, -3.0, 1.0},   {1.0, -1.0, 1.0},   {-1.0, -1.0, 1.0},  //bottom front center
-
-    {-1.0, -3.0, 3.0},  {1.0, -3.0, 3.0},   {1.0, -1.0, 3.0},   {-1.0, -1.0, 3.0},
-
-    {-1.0, -3.0, -3.0}, {1.0, -3.0, -3.0},  {1.0, -1.0, -3.0},  {-1.0, -1.0, -3.0},  //bottom back center
-    {-1.0, -3.0, -1.0}, {1.0, -3.0, -1.0},  {1.0, -1.0, -1.0},  {-1.0, -1.0, -1.0},
-
-    {-3.0, 1.0, -3.0},  {-1.0, 1.0, -3.0},  {-1.0, 3.0, -3.0},  {-3.0, 3.0, -3.0},  // top left back
-    {-3.0, 1.0, -1.0},  {-1.0, 1.0, -1.0},  {-1.0, 3.0, -1.0},  {-3.0, 3.0, -1.0},
-
-    {-3.0, 1.0, 1.0},   {-1.0, 1.0, 1.0},   {-1.0, 3.0, 1.0},   {-3.0, 3.0, 1.0},  // top left front
-    {-3.0, 1.0, 3.0},   {-1.0, 1.0, 3.0},   {-1.0, 3.0, 3.0},   {-3.0, 3.0, 3.0},
-
-    {1.0, 1.0, -3.0},   {3.0, 1.0, -3.0},   {3.0, 3.0, -3.0},   {1.0, 3.0, -3.0},  // top right  back
-    {1.0, 1.0, -1.0},   {3.0, 1.0, -1.0},   {3.0, 3.0, -1.0},   {1.0, 3.0, -1.0},
-
-    {1.0, 1.0, 1.0},    {3.0, 1.0, 1.0},    {3.0, 3.0, 1.0},    {1.0, 3.0, 1.0},  // top right  front
-    {1.0, 1.0, 3.0},    {3.0, 1.0, 3.0},    {3.0, 3.0, 3.0},
+static int speedmetercolor[15] = {6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6};  // color of the bars
+static int speedmetercount = -1;  // index of the last lit bar, every bar adds to speed
+static bool instant = false;  // queued moves are applied without animation
+static FrameProfiler profiler;
+static bool showProfiler = false;  // the overlay, toggled with 'o'
+static std::string profileCsv;  // written on exit, set by --profile or when the overlay is shown
 
-    {1.0, 3.0, 3.0},
-
-    {-3.0, -1.0, -3.0}, {-1.0, -1.0, -3.0}, {-1.0, 1.0, -3.0},  {-3.0, 1.0, -3.0},  //ceneter left back
-    {-3.0, -1.0, -1.0}, {-1.0, -1.0, -1.0}, {-1.0, 1.0, -1.0},  {-3.0, 1.0, -1.0},
-
-    {-3.0, -1.0, 1.0},  {-1.0, -1.0, 1.0},  {-1.0, 1.0, 1.0},   {-3.0, 1.0, 1.0},  //center left front
-    {-3.0, -1.0, 3.0},  {-1.0, -1.0, 3.0},  {-1.0, 1.0, 3.0},   {-3.0, 1.0, 3.0},
-
-    {1.0, -1.0, -3.0},  {3.0, -1.0, -3.0},  {3.0, 1.0, -3.0},   {1.0, 1.0, -3.0},  // center right back
-    {1.0, -1.0, -1.0},
-
-    {3.0, -1.0, -1.0},  {3.0, 1.0, -1.0},   {1.0, 1.0, -1.0},
-
-    {1.0, -1.0, 1.0},   {3.0, -1.0, 1.0},   {3.0, 1.0, 1.0},    {1.0, 1.0, 1.0},  // center right front
-    {1.0, -1.0, 3.0},   {3.0, -1.0, 3.0},   {3.0, 1.0, 3.0},    {1.0, 1.0, 3.0},
-
-    {-3.0, -3.0, -3.0}, {-1.0, -3.0, -3.0}, {-1.0, -1.0, -3.0}, {-3.0, -1.0, -3.0},  //bottom left back
-    {-3.0, -3.0, -1.0}, {-1.0, -3.0, -1.0}, {-1.0, -1.0, -1.0}, {-3.0, -1.0, -1.0},
-
-    {-3.0, -3.0, 1.0},  {-1.0, -3.0, 1.0},  {-1.0, -1.0, 1.0},
-
-    {-3.0, -1.0, 1.0},  //bottom left front
-    {-3.0, -3.0, 3.0},  {-1.0, -3.0, 3.0},  {-1.0, -1.0, 3.0},  {-3.0, -1.0, 3.0},
-
-    {1.0, -3.0, -3.0},  {3.0, -3.0, -3.0},  {3.0, -1.0, -3.0},  {1.0, -1.0, -3.0},  //bottom  right back
-    {1.0, -3.0, -1.0},  {3.0, -3.0, -1.0},  {3.0, -1.0, -1.0},  {1.0, -1.0, -1.0},
-
-    {1.0, -3.0, 1.0},   {3.0, -3.0, 1.0},   {3.0, -1.0, 1.0},   {1.0, -1.0, 1.0},  //bottom  right front
-    {1.0, -3.0, 3.0},   {3.0, -3.0, 3.0},   {3.0, -1.0, 3.0},   {1.0, -1.0, 3.0},
-
-    {0.0, 7.0, 0.0},    {0.0, 7.5, 0.0},    {0.5, 7.5, 0.0},  //speed meter
-    {0.5, 7.0, 0.0}};
+GLfloat speedmeter[][3] = {{0.0, 7.0, 0.0}, {0.0, 7.5, 0.0}, {0.5, 7.5, 0.0}, {0.5, 7.0, 0.0}};
 
 GLfloat color[][3] = {
     {1.0, 1.0, 1.0},  //white
@@ -149,269 +73,269 @@ GLfloat color[][3] = {
     {.6, .5, .6}      //speed meter colour
 };
 
-void polygon(int a, int b, int c, int d, int e) {
-  glColor3f(0, 0, 0);
-  glLineWidth(3.0);
-  glBegin(GL_LINE_LOOP);
-  glVertex3fv(vertices[b]);
-  glVertex3fv(vertices[c]);
-  glVertex3fv(vertices[d]);
-  glVertex3fv(vertices[e]);
-  glEnd();
-
-  glColor3fv(color[a]);
-  glBegin(GL_POLYGON);
-  glVertex3fv(vertices[b]);
-  glVertex3fv(vertices[c]);
-  glVertex3fv(vertices[d]);
-  glVertex3fv(vertices[e]);
-  glEnd();
-}
-
-void colorcube1() {
-  polygon(6, 0, 3, 2, 1);
-  polygon(6, 2, 3, 7, 6);
-  polygon(6, 0, 4, 7, 3);  // center piece
-  polygon(6, 1, 2, 6, 5);
-  polygon(6, 4, 5, 6, 7);
-  polygon(6, 0, 1, 5, 4);
-}
-
-void colorcube2() {
-  polygon(6, 8, 11, 10, 9);
-  polygon(6, 10, 11, 15, 14);
-  polygon(6, 8, 12, 15, 11);  // bottom center
-  polygon(6, 9, 10, 14, 13);
-  polygon(6, 12, 13, 14, 15);
-  polygon(bottom[1][1], 8, 9, 13, 12);
-}
-
-void colorcube3() {
-  polygon(6, 16, 19, 18, 17);
-  polygon(6, 18, 19, 23, 22);
-  polygon(left[1][1], 16, 20, 23, 19);  // left center
-  polygon(6, 17, 18, 22, 21);
-  polygon(6, 20, 21, 22, 23);
-  polygon(6, 16, 17, 21, 20);
-}
-
-void colorcube4() {
-  polygon(6, 24, 27, 26, 25);
-  polygon(6, 26, 27, 31, 30);
-  polygon(6, 24, 28, 31, 27);  // right center
-  polygon(right[1][1], 25, 26, 30, 29);
-  polygon(6, 28, 29, 30, 31);
-  polygon(6, 24, 25, 29, 28);
-}
-
-void colorcube5() {
-  polygon(6, 32, 35, 34, 33);
-  polygon(top[1][1], 34, 35, 39, 38);
-  polygon(6, 32, 36, 39, 35);  // top center
-  polygon(6, 33, 34, 38, 37);
-  polygon(6, 36, 37, 38, 39);
-  polygon(6, 32, 33, 37, 36);
-}
-
-void colorcube6() {
-  polygon(6, 40, 43, 42, 41);
-  polygon(6, 42, 43, 47, 46);
-  polygon(6, 40, 44, 47, 43);  // front center
-  polygon(6, 41, 42, 46, 45);
-  polygon(front[1][1], 44, 45, 46, 47);
-  polygon(6, 40, 41, 45, 44);
-}
-
-void colorcube7() {
-  polygon(back[1][1], 48, 51, 50, 49);
-  polygon(6, 50, 51, 55, 54);
-  polygon(6, 48, 52, 55, 51);  //back center
-  polygon(6, 49, 50, 54, 53);
-  polygon(6, 52, 53, 54, 55);
-  polygon(6, 48, 49, 53, 52);
-}
-
-void colorcube8() {
-  polygon(6, 56, 59, 58, 57);
-  polygon(top[1][0], 58, 59, 63, 62);
-  polygon(left[0][1], 56, 60, 63, 59);  // top left center
-  polygon(6, 57, 58, 62, 61);
-  polygon(6, 60, 61, 62, 63);
-  polygon(6, 56, 57, 61, 60);
-}
-
-void colorcube9() {
-  polygon(6, 64, 67, 66, 65);
-  polygon(top[1][2], 66, 67, 71, 70);
-  polygon(6, 64, 68, 71, 67);  // top right center
-  polygon(right[0][1], 65, 66, 70, 69);
-  polygon(6, 68, 69, 70, 71);
-  polygon(6, 64, 65, 69, 68);
-}
-
-void colorcube10() {
-  polygon(6, 72, 75, 74, 73);
-  polygon(top[2][1], 74, 75, 79, 78);
-  polygon(6, 72, 76, 79, 75);  // top front center
-  polygon(6, 73, 74, 78, 77);
-  polygon(front[0][1], 76, 77, 78, 79);
-  polygon(6, 72, 73, 77, 76);
-}
-
-void colorcube11() {
-  polygon(back[0][1], 80, 83, 82, 81);
-  polygon(top[0][1], 82, 83, 87, 86);
-  polygon(6, 80, 84, 87, 83);  // top back center
-  polygon(6, 81, 82, 86, 85);
-  polygon(6, 84, 85, 86, 87);
-  polygon(6, 80, 81, 85, 84);
-}
-
-void colorcube12() {
-  polygon(6, 80 + 8, 83 + 8, 82 + 8, 81 + 8);
-  polygon(6, 82 + 8, 83 + 8, 87 + 8, 86 + 8);
-  polygon(left[2][1], 80 + 8, 84 + 8, 87 + 8, 83 + 8);  // bottom left center
-  polygon(6, 81 + 8, 82 + 8, 86 + 8, 85 + 8);
-  polygon(6, 84 + 8, 85 + 8, 86 + 8, 87 + 8);
-  polygon(bottom[1][0], 80 + 8, 81 + 8, 85 + 8, 84 + 8);
-}
-
-void colorcube13() {
-  polygon(6, 80 + 16, 83 + 16, 82 + 16, 81 + 16);
-  polygon(6, 82 + 16, 83 + 16, 87 + 16, 86 + 16);
-  polygon(6, 80 + 16, 84 + 16, 87 + 16, 83 + 16);  // bottom right center
-  polygon(right[2][1], 81 + 16, 82 + 16, 86 + 16, 85 + 16);
-  polygon(6, 84 + 16, 85 + 16, 86 + 16, 87 + 16);
-  polygon(bottom[1][2], 80 + 16, 81 + 16, 85 + 16, 84 + 16);
-}
-
-void colorcube14() {
-  polygon(6, 80 + 24, 83 + 24, 82 + 24, 81 + 24);
-  polygon(6, 82 + 24, 83 + 24, 87 + 24, 86 + 24);
-  polygon(6, 80 + 24, 84 + 24, 87 + 24, 83 + 24);  // bottom front center
-  polygon(6, 81 + 24, 82 + 24, 86 + 24, 85 + 24);
-  polygon(front[2][1], 84 + 24, 85 + 24, 86 + 24, 87 + 24);
-  polygon(bottom[0][1], 80 + 24, 81 + 24, 85 + 24, 84 + 24);
-}
+// ############################ The scene: the 27 cubies, their stickers and the turning layers #########################
+// x points to the right, y up and z to the front. A cubie at position (x, y, z) occupies the box of size 2 around
+// (2x, 2y, 2z), its faces are in the order +x, -x, +y, -y, +z, -z, i.e. R L U D F B.
+struct Cubie {
+  int pos[3];  // -1..1 on every axis
+  int facelet[6];  // index into facelets of the sticker on the face, -1 for an interior face which is never drawn
+};
 
-void colorcube15() {
-  polygon(back[2][1], 112, 115, 114, 113);
-  polygon(6, 114, 115, 119, 118);
-  polygon(6, 112, 116, 119, 115);  // bottom back center
-  polygon(6, 113, 114, 118, 117);
-  polygon(6, 116, 117, 118, 119);
-  polygon(bottom[2][1], 112, 113, 117, 116);
+// Facelet of the sticker on face dir of the cubie at (x, y, z), rows and columns as in twophase::Fc.
+constexpr int stickerFacelet(int x, int y, int z, int dir) {
+  switch (dir) {
+    case 0: return x == 1 ? 9 * RIGHT + 3 * (1 - y) + (1 - z) : -1;
+    case 1: return x == -1 ? 9 * LEFT + 3 * (1 - y) + (z + 1) : -1;
+    case 2: return y == 1 ? 9 * TOP + 3 * (z + 1) + (x + 1) : -1;
+    case 3: return y == -1 ? 9 * BOTTOM + 3 * (1 - z) + (x + 1) : -1;
+    case 4: return z == 1 ? 9 * FRONT + 3 * (1 - y) + (x + 1) : -1;
+    default: return z == -1 ? 9 * BACK + 3 * (1 - y) + (1 - x) : -1;
+  }
 }
 
-void colorcube16() {
-  polygon(back[0][2], 120, 123, 122, 121);
-  polygon(top[0][0], 122, 123, 127, 126);
-  polygon(left[0][0], 120, 124, 127, 123);  // top left back
-  polygon(6, 121, 122, 126, 125);
-  polygon(6, 124, 125, 126, 127);
-  polygon(6, 120, 121, 125, 124);
-}
+static constexpr std::array<Cubie, 27> cubies = [] {
+  std::array<Cubie, 27> ret{};
+  for (int k = 0; k < 27; k++) {
+    Cubie &c = ret[k];
+    c.pos[0] = k % 3 - 1;
+    c.pos[1] = k / 3 % 3 - 1;
+    c.pos[2] = k / 9 - 1;
+    for (int dir = 0; dir < 6; dir++) c.facelet[dir] = stickerFacelet(c.pos[0], c.pos[1], c.pos[2], dir);
+  }
+  return ret;
+}();
+
+// A turn rotates all cubies with pos[axis] == layer by sign * theta around the axis, by -sign * theta if inverse.
+// Slice or wide turns only need another row here.
+struct Turn {
+  const char *name;
+  int axis, layer;
+  GLfloat sign;
+};
 
-void colorcube17() {
-  polygon(6, 128, 131, 130, 129);
-  polygon(top[2][0], 130, 131, 135, 134);
-  polygon(left[0][2], 128, 132, 135, 131);  // top left front
-  polygon(6, 129, 130, 134, 133);
-  polygon(front[0][0], 132, 133, 134, 135);
-  polygon(6, 128, 129, 133, 132);
+// Indexed by the rotation codes 1..6, 0 is no turn.
+static constexpr Turn turns[7] = {{"", 0, 0, 0},      {"U", 1, 1, -1},  {"R", 0, 1, -1}, {"F", 2, 1, -1},
+                                  {"L", 0, -1, 1}, {"B", 2, -1, 1}, {"D", 1, -1, 1}};
+
+// Bit k is set if cubie k is in the turning layer.
+static constexpr std::array<uint32_t, 7> turnLayers = [] {
+  std::array<uint32_t, 7> ret{};
+  for (int t = 1; t < 7; t++)
+    for (int k = 0; k < 27; k++)
+      if (cubies[k].pos[turns[t].axis] == turns[t].layer) ret[t] |= 1u << k;
+  return ret;
+}();
+
+// ########## Retained-mode renderer, the stickers are uploaded once into vertex buffers and drawn with a few calls #####
+// The faces of cubie k are the quads cubieFirst[k] .. cubieFirst[k] + cubieCount[k] - 1 (in vertices). After them
+// follow the grey cut squares, the square at -1 and +1 of every axis, which cover the gap opened by a turn.
+static std::vector<GLfloat> faceVertices, faceColors;
+static GLint cubieFirst[27], cubieCount[27], cutFirst[3][2];
+static GLuint vertexBuffer, colorBuffer;
+static GLsizeiptr stickerColorsSize;
+
+// Quad perpendicular to axis at coordinate at, spanning -size..size around center on the other axes.
+void addQuad(int axis, GLfloat at, const GLfloat center[3], GLfloat size) {
+  static const int corners[4][2] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+  int u = (axis + 1) % 3, v = (axis + 2) % 3;
+  for (auto &corner : corners) {
+    GLfloat vertex[3];
+    vertex[axis] = at;
+    vertex[u] = center[u] + corner[0] * size;
+    vertex[v] = center[v] + corner[1] * size;
+    faceVertices.insert(faceVertices.end(), vertex, vertex + 3);
+  }
 }
 
-void colorcube18() {
-  polygon(back[0][0], 136, 139, 138, 137);
-  polygon(top[0][2], 138, 139, 143, 142);
-  polygon(6, 136, 140, 143, 139);  // top right back
-  polygon(right[0][2], 137, 138, 142, 141);
-  polygon(6, 140, 141, 142, 143);
-  polygon(6, 136, 137, 141, 140);
-}
+// Colors of the sticker faces in the order of the vertices, the cut squares are not included.
+void captureColors() {
+  faceColors.clear();
+  for (const Cubie &c : cubies)
+    for (int dir = 0; dir < 6; dir++)
+      if (c.facelet[dir] >= 0) {
+        const GLfloat *rgb = color[faceColor[facelets[c.facelet[dir]]]];
+        for (int i = 0; i < 4; i++) faceColors.insert(faceColors.end(), rgb, rgb + 3);
+      }
+}
+
+// Upload the geometry once, needs the GL context.
+void initRenderer() {
+  faceVertices.clear();
+  for (int k = 0; k < 27; k++) {
+    const Cubie &c = cubies[k];
+    GLfloat center[3] = {2.0f * c.pos[0], 2.0f * c.pos[1], 2.0f * c.pos[2]};
+    cubieFirst[k] = GLint(faceVertices.size() / 3);
+    for (int dir = 0; dir < 6; dir++)
+      if (c.facelet[dir] >= 0) addQuad(dir / 2, center[dir / 2] + (dir % 2 == 0 ? 1 : -1), center, 1);
+    cubieCount[k] = GLint(faceVertices.size() / 3) - cubieFirst[k];
+  }
+  captureColors();
+  stickerColorsSize = GLsizeiptr(faceColors.size() * sizeof(GLfloat));
+  const GLfloat origin[3] = {0, 0, 0};
+  for (int axis = 0; axis < 3; axis++)
+    for (int side = 0; side < 2; side++) {
+      cutFirst[axis][side] = GLint(faceVertices.size() / 3);
+      addQuad(axis, side == 0 ? -1 : 1, origin, 3);
+      for (int i = 0; i < 4; i++) faceColors.insert(faceColors.end(), color[6], color[6] + 3);
+    }
 
-void colorcube19() {
-  polygon(6, 144, 147, 146, 145);
-  polygon(top[2][2], 146, 147, 151, 150);
-  polygon(6, 144, 148, 151, 147);  // top right front
-  polygon(right[0][0], 145, 146, 150, 149);
-  polygon(front[0][2], 148, 149, 150, 151);
-  polygon(6, 144, 145, 149, 148);
-}
+  glGenBuffers(1, &vertexBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+  glBufferData(GL_ARRAY_BUFFER, faceVertices.size() * sizeof(GLfloat), faceVertices.data(), GL_STATIC_DRAW);
+  glGenBuffers(1, &colorBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, colorBuffer);
+  glBufferData(GL_ARRAY_BUFFER, faceColors.size() * sizeof(GLfloat), faceColors.data(), GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Only the sticker colors change when a move has been applied.
+void updateColors() {
+  captureColors();
+  glBindBuffer(GL_ARRAY_BUFFER, colorBuffer);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, stickerColorsSize, faceColors.data());
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Draw the cubies of the turning layer (moving = true) or all others, black outlines first so the faces drawn at the
+// same depth do not cover them. During a turn both sides also draw the cut squares between the layer and the rest.
+void drawCubies(bool moving) {
+  GLint first[27 + 2];
+  GLsizei count[27 + 2];
+  GLsizei n = 0;
+  for (int k = 0; k < 27; k++) {
+    if (bool(turnLayers[rotation] >> k & 1) != moving || cubieCount[k] == 0) continue;
+    first[n] = cubieFirst[k];
+    count[n++] = cubieCount[k];
+  }
+  if (rotation != 0) {
+    const Turn &t = turns[rotation];
+    for (int bound : {2 * t.layer - 1, 2 * t.layer + 1})  // boundaries of the layer, -3 and 3 are the cube's surface
+      if (bound == -1 || bound == 1) {
+        first[n] = cutFirst[t.axis][bound > 0];
+        count[n++] = 4;
+      }
+  }
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+  glVertexPointer(3, GL_FLOAT, 0, nullptr);
 
-void colorcube20() {
-  polygon(back[1][2], 152, 155, 154, 153);
-  polygon(6, 154, 155, 159, 158);
-  polygon(left[1][0], 152, 156, 159, 155);  //center left back
-  polygon(6, 153, 154, 158, 157);
-  polygon(6, 156, 157, 158, 159);
-  polygon(6, 152, 153, 157, 156);
-}
+  int vertices = 0;
+  for (GLsizei i = 0; i < n; i++) vertices += count[i];
 
-void colorcube21() {
-  polygon(6, 160, 163, 162, 161);
-  polygon(6, 162, 163, 167, 166);
-  polygon(left[1][2], 160, 164, 167, 163);  // center left front
-  polygon(6, 161, 162, 166, 165);
-  polygon(front[1][0], 164, 165, 166, 167);
-  polygon(6, 160, 161, 165, 164);
+  glColor3f(0, 0, 0);
+  glLineWidth(3.0);
+  glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+  glMultiDrawArrays(GL_QUADS, first, count, n);
+  profiler.draw(vertices);
+
+  glEnableClientState(GL_COLOR_ARRAY);
+  glBindBuffer(GL_ARRAY_BUFFER, colorBuffer);
+  glColorPointer(3, GL_FLOAT, 0, nullptr);
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  glMultiDrawArrays(GL_QUADS, first, count, n);
+  profiler.draw(vertices);
+
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Show the search started with 's', updated every frame while it runs.
+void solveStatus() {
+  BackgroundSolver::Status st = backgroundSolver.status();
+  if (!st.active) return;
+  char line[64];
+  int length = st.best.empty() ? 0 : atoi(st.best.substr(st.best.rfind('(') + 1).c_str());
+  if (st.best.empty())
+    snprintf(line, sizeof line, "Solving... %.1fs", st.elapsed);
+  else if (st.best.rfind("Error", 0) == 0)
+    snprintf(line, sizeof line, "%s", st.best.c_str());
+  else
+    snprintf(line, sizeof line, "%s %d moves, %.1fs", st.running ? "Solving... best" : "Solved in", length, st.elapsed);
+  glColor3fv(color[0]);
+  output(-9, -8, line);
+  if (!st.running && st.best.rfind("Error", 0) != 0) output(-9, -9, st.best.c_str());
 }
 
-void colorcube22() {
-  polygon(back[1][0], 168, 171, 170, 169);
-  polygon(6, 170, 171, 175, 174);
-  polygon(6, 168, 172, 175, 171);  // center right back
-  polygon(right[1][2], 169, 170, 174, 173);
-  polygon(6, 172, 173, 174, 175);
-  polygon(6, 168, 169, 173, 172);
-}
+static bool solveTicking = false;
 
-void colorcube23() {
-  polygon(6, 176, 179, 178, 177);
-  polygon(6, 178, 179, 183, 182);
-  polygon(6, 176, 180, 183, 179);  //center right front
-  polygon(right[1][0], 177, 178, 182, 181);
-  polygon(front[1][2], 180, 181, 182, 183);
-  polygon(6, 176, 177, 181, 180);
+// Redraw the search status until the search has finished.
+void solveTick(int) {
+  glutPostRedisplay();
+  BackgroundSolver::Status st = backgroundSolver.status();
+  if (st.running) {
+    glutTimerFunc(100, solveTick, 0);
+    return;
+  }
+  solveTicking = false;
+  if (st.active)
+    std::cout << "The solution is: " << st.best << "\n Don't forget to face Blue with Orange to the right!\n";
 }
 
-void colorcube24() {
-  polygon(back[2][2], 184, 187, 186, 185);
-  polygon(6, 186, 187, 191, 190);
-  polygon(left[2][0], 184, 188, 191, 187);  // bottom left back
-  polygon(6, 185, 186, 190, 189);
-  polygon(6, 188, 189, 190, 191);
-  polygon(bottom[2][0], 184, 185, 189, 188);
+void startSolve() {
+  backgroundSolver.start(queuedCube);
+  if (!solveTicking) glutTimerFunc(100, solveTick, 0);
+  solveTicking = true;
 }
 
-void colorcube25() {
-  polygon(6, 192, 195, 194, 193);
-  polygon(6, 194, 195, 199, 198);
-  polygon(left[2][2], 192, 196, 199, 195);  // bottom left front
-  polygon(6, 193, 194, 198, 197);
-  polygon(front[2][0], 196, 197, 198, 199);
-  polygon(bottom[0][0], 192, 193, 197, 196);
+// One bar per speed step above the slowest speed.
+void speedMeter() {
+  for (int i = 0; i < 15; i++) {
+    GLfloat dx = -5.0f + 0.7f * i;
+    glColor3fv(color[speedmetercolor[i]]);
+    glRectf(speedmeter[0][0] + dx, speedmeter[0][1], speedmeter[2][0] + dx, speedmeter[2][1]);
+    profiler.draw(4);
+  }
 }
 
-void colorcube26() {
-  polygon(back[2][0], 200, 203, 202, 201);
-  polygon(6, 202, 203, 207, 206);
-  polygon(6, 200, 204, 207, 203);  // bottom right back
-  polygon(right[2][2], 201, 202, 206, 205);
-  polygon(6, 204, 205, 206, 207);
-  polygon(bottom[2][2], 200, 201, 205, 204);
+// Frame times of the last frames as a graph in the upper right corner, the line marks 60 frames per second, and the
+// numbers of the last frame in the upper left corner. Drawn after the frame has been measured.
+void profilerOverlay() {
+  const std::deque<FrameProfiler::Frame> &frames = profiler.frames();
+  if (frames.empty()) return;
+  const GLfloat left = 2.5f, bottom = 8.0f, width = 7.0f, height = 1.8f, fullMs = 50.0f;
+  std::vector<GLfloat> graph;
+  size_t first = frames.size() > FrameProfiler::GRAPH_FRAMES ? frames.size() - FrameProfiler::GRAPH_FRAMES : 0;
+  for (size_t i = first; i < frames.size(); i++) {
+    graph.push_back(left + width * GLfloat(i - first) / FrameProfiler::GRAPH_FRAMES);
+    graph.push_back(bottom + height * std::min(GLfloat(frames[i].frameMs) / fullMs, 1.0f));
+  }
+  const GLfloat target = bottom + height * (1000.0f / 60) / fullMs;
+  const GLfloat marks[] = {left, bottom, left + width, bottom, left, target, left + width, target};
+
+  glDisable(GL_DEPTH_TEST);
+  glLineWidth(1.0);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glColor3fv(color[6]);
+  glVertexPointer(2, GL_FLOAT, 0, marks);
+  glDrawArrays(GL_LINES, 0, 4);
+  glColor3fv(color[3]);
+  glVertexPointer(2, GL_FLOAT, 0, graph.data());
+  glDrawArrays(GL_LINE_STRIP, 0, GLsizei(graph.size() / 2));
+  glDisableClientState(GL_VERTEX_ARRAY);
+
+  const FrameProfiler::Frame &last = frames.back();
+  char line[96];
+  glColor3fv(color[0]);
+  snprintf(line, sizeof line, "frame p50 %.1f ms  p99 %.1f ms", profiler.percentile(50), profiler.percentile(99));
+  output(-9, 9, line);
+  snprintf(line, sizeof line, "display %.2f ms  %d draws  %d vertices", last.displayMs, last.drawCalls, last.vertices);
+  output(-9, 8, line);
+  snprintf(line, sizeof line, "network %.3f ms", last.networkMs);
+  output(-9, 7, line);
+  glEnable(GL_DEPTH_TEST);
 }
 
-void colorcube27() {
-  polygon(6, 208, 211, 210, 209);
-  polygon(6, 210, 211, 215, 214);
-  polygon(6, 208, 212, 215, 211);  // bottom right front
-  polygon(right[2][0], 209, 210, 214, 213);
-  polygon(front[2][2], 212, 213, 214, 215);
-  polygon(bottom[0][2], 208, 209, 213, 212);
+void writeProfile() {
+  if (profileCsv.empty()) return;
+  if (profiler.writeCsv(profileCsv))
+    std::cout << "Frame profile written to " << profileCsv << "\n";
+  else
+    std::cerr << "Cannot write the frame profile to " << profileCsv << "\n";
 }
 
 void display() {
+  profiler.beginFrame();
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   glLoadIdentity();
 
@@ -420,569 +344,120 @@ void display() {
   glRotatef(-30.0 + q, 0.0, 1.0, 0.0);
   glRotatef(0.0 + r, 0.0, 0.0, 1.0);
 
-  if (rotation == 0) {
-    colorcube1();
-    colorcube2();
-    colorcube3();
-    colorcube4();
-    colorcube5();
-    colorcube6();
-    colorcube7();
-    colorcube8();
-    colorcube9();
-    colorcube10();
-    colorcube11();
-    colorcube12();
-    colorcube13();
-    colorcube14();
-    colorcube15();
-    colorcube16();
-    colorcube17();
-    colorcube18();
-    colorcube19();
-    colorcube20();
-    colorcube21();
-    colorcube22();
-    colorcube23();
-    colorcube24();
-    colorcube25();
-    colorcube26();
-    colorcube27();
-  }
-  if (rotation == 1) {
-    colorcube1();
-    colorcube2();
-    colorcube3();
-    colorcube4();
-    colorcube6();
-    colorcube7();
-    colorcube12();
-    colorcube13();
-    colorcube14();
-    colorcube15();
-    colorcube20();
-    colorcube21();
-    colorcube22();
-    colorcube23();
-    colorcube24();
-    colorcube25();
-    colorcube26();
-    colorcube27();
-    if (inverse == 0) {
-      glPushMatrix();
-      glColor3fv(color[0]);
-      output(-11, 6, "U");
-      glPopMatrix();
-      glRotatef(-theta, 0.0, 1.0, 0.0);
-    } else {
-      glPushMatrix();
-      glColor3fv(color[0]);
-      output(-11, 6, "U'");
-      glPopMatrix();
-      glRotatef(theta, 0.0, 1.0, 0.0);
-    }
-    colorcube5();
-    colorcube8();
-    colorcube9();
-    colorcube10();
-    colorcube11();
-    colorcube16();
-    colorcube17();
-    colorcube18();
-    colorcube19();
-  }
-  if (rotation == 2) {
-    colorcube1();
-    colorcube2();
-    colorcube3();
-    colorcube5();
-    colorcube6();
-    colorcube7();
-    colorcube8();
-    colorcube10();
-    colorcube11();
-    colorcube12();
-    colorcube14();
-    colorcube15();
-    colorcube16();
-    colorcube17();
-    colorcube20();
-    colorcube21();
-    colorcube24();
-    colorcube25();
-    if (inverse == 0) {
-      glPushMatrix();
-      glColor3fv(color[0]);
-      output(-11, 6, "R");
-      glPopMatrix();
-      glRotatef(-theta, 1.0, 0.0, 0.0);
-    } else {
-      glPushMatrix();
-      glColor3fv(color[0]);
-      output(-11, 6, "R'");
-      glPopMatrix();
-      glRotatef(theta, 1.0, 0.0, 0.0);
-    }
-    colorcube4();
-    colorcube9();
-    colorcube13();
-    colorcube18();
-    colorcube19();
-    colorcube22();
-    colorcube23();
-    colorcube26();
-    colorcube27();
-  }
-  if (rotation == 3) {
-    colorcube1();
-    colorcube2();
-    colorcube3();
-    colorcube4();
-    colorcube5();
-    colorcube7();
-    colorcube8();
-    colorcube9();
-    colorcube11();
-    colorcube12();
-    colorcube13();
-    colorcube15();
-    colorcube16();
-    colorcube18();
-    colorcube20();
-    colorcube22();
-    colorcube24();
-    colorcube26();
-    if (inverse == 0) {
-      glPushMatrix();
-      glColor3fv(color[0]);
-      output(-11, 6, "F");
-      glPopMatrix();
-      glRotatef(-theta, 0.0, 0.0, 1.0);
-    } else {
-      glPushMatrix();
-      glColor3fv(color[0]);
-      output(-11, 6, "F'");
-      glPopMatrix();
-      glRotatef(theta, 0.0, 0.0, 1.0);
-    }
-    colorcube6();
-    colorcube10();
-    colorcube14();
-    colorcube17();
-    colorcube19();
-    colorcube21();
-    colorcube23();
-    colorcube25();
-    colorcube27();
-  }
-  if (rotation == 4) {
-    colorcube1();
-    colorcube2();
-    colorcube4();
-    colorcube5();
-    colorcube6();
-    colorcube7();
-    colorcube9();
-    colorcube10();
-    colorcube11();
-    colorcube13();
-    colorcube14();
-    colorcube15();
-    colorcube18();
-    colorcube19();
-    colorcube22();
-    colorcube23();
-    colorcube26();
-    colorcube27();
-    if (inverse == 0) {
-      glPushMatrix();
-      glColor3fv(color[0]);
-      output(-11, 6, "L");
-      glPopMatrix();
-      glRotatef(theta, 1.0, 0.0, 0.0);
-    } else {
-      glPushMatrix();
-      glColor3fv(color[0]);
-      output(-11, 6, "L'");
-      glPopMatrix();
-      glRotatef(-theta, 1.0, 0.0, 0.0);
-    }
-    colorcube3();
-    colorcube8();
-    colorcube12();
-    colorcube16();
-    colorcube17();
-    colorcube20();
-    colorcube21();
-    colorcube24();
-    colorcube25();
-  }
-  if (rotation == 5) {
-    colorcube1();
-    colorcube2();
-    colorcube3();
-    colorcube4();
-    colorcube5();
-    colorcube6();
-    colorcube8();
-    colorcube9();
-    colorcube10();
-    colorcube12();
-    colorcube13();
-    colorcube14();
-    colorcube17();
-    colorcube19();
-    colorcube21();
-    colorcube23();
-    colorcube25();
-    colorcube27();
-    if (inverse == 0) {
-      glPushMatrix();
-      glColor3fv(color[0]);
-      output(-11, 6, "B");
-      glPopMatrix();
-      glRotatef(theta, 0.0, 0.0, 1.0);
-    } else {
-      glPushMatrix();
-      glColor3fv(color[0]);
-      output(-11, 6, "B'");
-      glPopMatrix();
-      glRotatef(-theta, 0.0, 0.0, 1.0);
-    }
-    colorcube7();
-    colorcube11();
-    colorcube15();
-    colorcube16();
-    colorcube18();
-    colorcube20();
-    colorcube22();
-    colorcube24();
-    colorcube26();
-  }
-  if (rotation == 6) {
-    colorcube1();
-    colorcube3();
-    colorcube4();
-    colorcube5();
-    colorcube6();
-    colorcube7();
-    colorcube8();
-    colorcube9();
-    colorcube10();
-    colorcube11();
-    colorcube16();
-    colorcube17();
-    colorcube18();
-    colorcube19();
-    colorcube20();
-    colorcube21();
-    colorcube22();
-    colorcube23();
-    if (inverse == 0) {
-      glPushMatrix();
-      glColor3fv(color[0]);
-      output(-11, 6, "D");
-      glPopMatrix();
-      glRotatef(theta, 0.0, 1.0, 0.0);
-    } else {
-      glPushMatrix();
-      glColor3fv(color[0]);
-      output(-11, 6, "D'");
-      glPopMatrix();
-      glRotatef(-theta, 0.0, 1.0, 0.0);
-    }
-    colorcube2();
-    colorcube12();
-    colorcube13();
-    colorcube14();
-    colorcube15();
-    colorcube24();
-    colorcube25();
-    colorcube26();
-    colorcube27();
+  drawCubies(false);
+  if (rotation != 0) {
+    const Turn &t = turns[rotation];
+    std::string label = std::string(t.name) + (halfturn ? "2" : inverse ? "'" : "");
+    glPushMatrix();
+    glColor3fv(color[0]);
+    output(-11, 6, label.c_str());
+    glPopMatrix();
+    glRotatef((inverse == 0 ? theta : -theta) * t.sign, t.axis == 0, t.axis == 1, t.axis == 2);
+    drawCubies(true);
   }
 
   glPopMatrix();
+  speedMeter();
+  solveStatus();
+  profiler.endFrame();
+  if (showProfiler) profilerOverlay();
   glFlush();
   glutSwapBuffers();
 }
 
-void transpose(char a) {
-  if (a == 'r') {
-    int temp;
-    temp = right[0][0];
-    right[0][0] = right[2][0];
-    right[2][0] = right[2][2];
-    right[2][2] = right[0][2];
-    right[0][2] = temp;
-    temp = right[1][0];
-    right[1][0] = right[2][1];
-    right[2][1] = right[1][2];
-    right[1][2] = right[0][1];
-    right[0][1] = temp;
-  }
-  if (a == 't') {
-    int temp;
-    temp = top[0][0];
-    top[0][0] = top[2][0];
-    top[2][0] = top[2][2];
-    top[2][2] = top[0][2];
-    top[0][2] = temp;
-    temp = top[1][0];
-    top[1][0] = top[2][1];
-    top[2][1] = top[1][2];
-    top[1][2] = top[0][1];
-    top[0][1] = temp;
-  }
-  if (a == 'f') {
-    int temp;
-    temp = front[0][0];
-    front[0][0] = front[2][0];
-    front[2][0] = front[2][2];
-    front[2][2] = front[0][2];
-    front[0][2] = temp;
-    temp = front[1][0];
-    front[1][0] = front[2][1];
-    front[2][1] = front[1][2];
-    front[1][2] = front[0][1];
-    front[0][1] = temp;
-  }
-  if (a == 'l') {
-    int temp;
-    temp = left[0][0];
-    left[0][0] = left[2][0];
-    left[2][0] = left[2][2];
-    left[2][2] = left[0][2];
-    left[0][2] = temp;
-    temp = left[1][0];
-    left[1][0] = left[2][1];
-    left[2][1] = left[1][2];
-    left[1][2] = left[0][1];
-    left[0][1] = temp;
-  }
-  if (a == 'k') {
-    int temp;
-    temp = back[0][0];
-    back[0][0] = back[2][0];
-    back[2][0] = back[2][2];
-    back[2][2] = back[0][2];
-    back[0][2] = temp;
-    temp = back[1][0];
-    back[1][0] = back[2][1];
-    back[2][1] = back[1][2];
-    back[1][2] = back[0][1];
-    back[0][1] = temp;
-  }
-  if (a == 'b') {
-    int temp;
-    temp = bottom[0][0];
-    bottom[0][0] = bottom[2][0];
-    bottom[2][0] = bottom[2][2];
-    bottom[2][2] = bottom[0][2];
-    bottom[0][2] = temp;
-    temp = bottom[1][0];
-    bottom[1][0] = bottom[2][1];
-    bottom[2][1] = bottom[1][2];
-    bottom[1][2] = bottom[0][1];
-    bottom[0][1] = temp;
-  }
-}
-
-void topc() {
-  transpose('t');
-  int temp1 = front[0][0];
-  int temp2 = front[0][1];
-  int temp3 = front[0][2];
-
-  front[0][0] = right[0][0];
-  front[0][1] = right[0][1];
-  front[0][2] = right[0][2];
-
-  right[0][0] = back[0][0];
-  right[0][1] = back[0][1];
-  right[0][2] = back[0][2];
-
-  back[0][0] = left[0][0];
-  back[0][1] = left[0][1];
-  back[0][2] = left[0][2];
-
-  left[0][0] = temp1;
-  left[0][1] = temp2;
-  left[0][2] = temp3;
-}
-
-void frontc() {
-  transpose('f');
-  int temp1 = left[0][2];
-  int temp2 = left[1][2];
-  int temp3 = left[2][2];
-
-  left[0][2] = bottom[0][0];
-  left[1][2] = bottom[0][1];
-  left[2][2] = bottom[0][2];
-
-  bottom[0][0] = right[2][0];
-  bottom[0][1] = right[1][0];
-  bottom[0][2] = right[0][0];
-
-  right[2][0] = top[2][2];
-  right[1][0] = top[2][1];
-  right[0][0] = top[2][0];
-
-  top[2][2] = temp1;
-  top[2][1] = temp2;
-  top[2][0] = temp3;
-}
-
-void rightc() {
-  transpose('r');
-  int temp1 = top[0][2];
-  int temp2 = top[1][2];
-  int temp3 = top[2][2];
-
-  top[0][2] = front[0][2];
-  top[1][2] = front[1][2];
-  top[2][2] = front[2][2];
-
-  front[0][2] = bottom[0][2];
-  front[1][2] = bottom[1][2];
-  front[2][2] = bottom[2][2];
-
-  bottom[0][2] = back[2][0];
-  bottom[1][2] = back[1][0];
-  bottom[2][2] = back[0][0];
-
-  back[2][0] = temp1;
-  back[1][0] = temp2;
-  back[0][0] = temp3;
-}
-
-void leftc() {
-  transpose('l');
-  int temp1 = front[0][0];
-  int temp2 = front[1][0];
-  int temp3 = front[2][0];
+// Animation runs on the monotonic clock, a quarter turn takes the same time on every machine: speed degrees per frame
+// at 60 frames per second as before. spincube() is the idle function only while a turn is animating.
+using Clock = std::chrono::steady_clock;
+static const Clock::duration framePeriod = std::chrono::microseconds(1'000'000 / 60);  // target frame rate
+static Clock::time_point turnStart, nextFrame;
 
-  front[0][0] = top[0][0];
-  front[1][0] = top[1][0];
-  front[2][0] = top[2][0];
+void nextTurn();
 
-  top[0][0] = back[2][2];
-  top[1][0] = back[1][2];
-  top[2][0] = back[0][2];
-
-  back[2][2] = bottom[0][0];
-  back[1][2] = bottom[1][0];
-  back[0][2] = bottom[2][0];
+void spincube() {
+  // Pace the frames: wait for the next frame time unless drawing already took that long, e.g. blocked by vsync.
+  Clock::time_point now = Clock::now();
+  if (now < nextFrame) {
+    std::this_thread::sleep_until(nextFrame);
+    now = nextFrame;
+  }
+  nextFrame = now + framePeriod;
 
-  bottom[0][0] = temp1;
-  bottom[1][0] = temp2;
-  bottom[2][0] = temp3;
+  theta = GLfloat(std::chrono::duration<double>(now - turnStart).count() * 60 * (0.5 + speed));
+  if (theta >= (halfturn ? 180.0 : 90.0)) {
+    rotationcomplete = 1;
+    glutIdleFunc(NULL);
+    if (turnMove >= 0) {
+      cube.apply(turnMove);
+      facelets = cube.facelets();
+      updateColors();
+    }
+    rotation = 0;
+    turnMove = -1;
+    theta = 0;
+    nextTurn();
+  }
+  glutPostRedisplay();
 }
 
-void backc() {
-  transpose('k');
-  int temp1 = top[0][0];
-  int temp2 = top[0][1];
-  int temp3 = top[0][2];
-
-  top[0][0] = right[0][2];
-  top[0][1] = right[1][2];
-  top[0][2] = right[2][2];
-
-  right[0][2] = bottom[2][2];
-  right[1][2] = bottom[2][1];
-  right[2][2] = bottom[2][0];
-
-  bottom[2][2] = left[2][0];
-  bottom[2][1] = left[1][0];
-  bottom[2][0] = left[0][0];
-
-  left[2][0] = temp1;
-  left[1][0] = temp2;
-  left[0][0] = temp3;
+// ####################### Move queue: typed keys, menu entries and solution playback are played in order ###############
+// Start the next queued move unless a turn is animating. In instant mode the whole queue is applied at once.
+void nextTurn() {
+  if (rotationcomplete == 0 || moveQueue.empty()) return;
+  if (instant) {
+    for (int m : moveQueue) cube.apply(m);
+    moveQueue.clear();
+    facelets = cube.facelets();
+    updateColors();
+    glutPostRedisplay();
+    return;
+  }
+  turnMove = moveQueue.front();
+  moveQueue.pop_front();
+  rotationcomplete = 0;
+  rotation = faceRotation[turnMove / 3];
+  inverse = turnMove % 3 == 2;
+  halfturn = turnMove % 3 == 1;
+  turnStart = Clock::now();
+  glutIdleFunc(spincube);
 }
 
-void bottomc() {
-  transpose('b');
-  int temp1 = front[2][0];
-  int temp2 = front[2][1];
-  int temp3 = front[2][2];
-
-  front[2][0] = left[2][0];
-  front[2][1] = left[2][1];
-  front[2][2] = left[2][2];
+static bool flushTicking = false;
 
-  left[2][0] = back[2][0];
-  left[2][1] = back[2][1];
-  left[2][2] = back[2][2];
-
-  back[2][0] = right[2][0];
-  back[2][1] = right[2][1];
-  back[2][2] = right[2][2];
-
-  right[2][0] = temp1;
-  right[2][1] = temp2;
-  right[2][2] = temp3;
+// Hand the moves of a burst which did not fit into the ring of the MoveReporter over, also when no key follows.
+void flushTick(int) {
+  flushTicking = !moveReporter.flush();
+  if (flushTicking) glutTimerFunc(10, flushTick, 0);
 }
 
-void spincube() {
-  theta += 0.5 + speed;
-  if (theta == 360.0) theta -= 360.0;
-  if (theta >= 90.0) {
-    rotationcomplete = 1;
-    glutIdleFunc(NULL);
-    if (rotation == 1 && inverse == 0) {
-      topc();
-    }
-    if (rotation == 1 && inverse == 1) {
-      topc();
-      topc();
-      topc();
-    }
-    if (rotation == 2 && inverse == 0) {
-      rightc();
-    }
-    if (rotation == 2 && inverse == 1) {
-      rightc();
-      rightc();
-      rightc();
-    }
-    if (rotation == 3 && inverse == 0) {
-      frontc();
-    }
-    if (rotation == 3 && inverse == 1) {
-      frontc();
-      frontc();
-      frontc();
-    }
-    if (rotation == 4 && inverse == 0) {
-      leftc();
-    }
-    if (rotation == 4 && inverse == 1) {
-      leftc();
-      leftc();
-      leftc();
-    }
-    if (rotation == 5 && inverse == 0) {
-      backc();
-    }
-    if (rotation == 5 && inverse == 1) {
-      backc();
-      backc();
-      backc();
-    }
-    if (rotation == 6 && inverse == 0) {
-      bottomc();
-    }
-    if (rotation == 6 && inverse == 1) {
-      bottomc();
-      bottomc();
-      bottomc();
-    }
-    rotation = 0;
-    theta = 0;
+void queueMove(int m) {
+  static const char faces[] = "urfdlb";
+  backgroundSolver.cancel();  // the search is for the old cube
+  FrameProfiler::Clock::time_point start = FrameProfiler::Clock::now();
+  for (int k = 0; k <= m % 3; k++) updCubeString(faces[m / 3]);  // the backend knows quarter turns only
+  if (!flushTicking && !moveReporter.flush()) {
+    flushTicking = true;
+    glutTimerFunc(10, flushTick, 0);
   }
+  profiler.blocked(FrameProfiler::Clock::now() - start);
+  queuedCube.apply(m);
+  moveQueue.push_back(m);
+  nextTurn();
+}
+
+// Play the solution found with 's'.
+void playSolution() {
+  BackgroundSolver::Status st = backgroundSolver.status();
+  std::vector<int> moves;
+  if (!st.active || st.running || !parse_moves(st.best, moves)) return;
+  for (int m : moves) queueMove(m);
+}
+
+// Every lit bar of the speed meter adds 0.5 degrees per frame.
+void changeSpeed(int step) {
+  int count = std::clamp(speedmetercount + step, -1, 14);
+  speed += 0.5f * (count - speedmetercount);
+  speedmetercount = count;
+  for (int i = 0; i < 15; i++) speedmetercolor[i] = i <= speedmetercount ? 7 : 6;
   glutPostRedisplay();
 }
 
@@ -1004,63 +479,36 @@ void mouse(int btn, int state, int x, int y) {
   }
 }
 
-static void keyboard(unsigned char key, int x, int y) {
-  if (rotationcomplete == 1) {
-    switch (key) {
-      case 'u':  // U move
-        rotationcomplete = 0;
-        rotation = 1;
-        inverse = 0;
-        glutIdleFunc(spincube);
-        updCubeString('u');
-        break;
-
-      case 'r':  // R move
-        rotationcomplete = 0;
-        rotation = 2;
-        inverse = 0;
-        glutIdleFunc(spincube);
-        updCubeString('r');
-        break;
-
-      case 'f':  // F move
-        rotationcomplete = 0;
-        rotation = 3;
-        inverse = 0;
-        glutIdleFunc(spincube);
-        updCubeString('f');
-        break;
-
-      case 'd':  // D move
-        rotationcomplete = 0;
-        rotation = 6;
-        inverse = 0;
-        glutIdleFunc(spincube);
-        updCubeString('d');
-        break;
-
-      case 'l':  // L move
-        rotationcomplete = 0;
-        rotation = 4;
-        inverse = 0;
-        glutIdleFunc(spincube);
-        updCubeString('l');
-        break;
-
-      case 'b':  // B move
-        rotationcomplete = 0;
-        rotation = 5;
-        inverse = 0;
-        glutIdleFunc(spincube);
-        updCubeString('b');
-        break;
-
-      case 's':  // Solve
-        auto resulting = "The solution is: " + solveCube() + "\n Don't forget to face Blue with Orange to the right!\n";
-        std::cout << resulting;
-        output(-11, 5, resulting.c_str());
-        break;
-    }
+// u r f d l b turn a face clockwise, upper case counterclockwise. Keys typed during a turn are queued.
+static void keyboard(unsigned char key, int, int) {
+  static const std::string faces = "urfdlb";  // order of the twophase faces
+  size_t face = faces.find(char(tolower(key)));
+  if (key != 0 && face != std::string::npos) {
+    queueMove(3 * int(face) + (isupper(key) ? 2 : 0));
+    return;
+  }
+  switch (key) {
+    case 's':  // Solve
+      startSolve();
+      break;
+    case 'p':  // Play the solution
+      playSolution();
+      break;
+    case 'i':  // Toggle instant moves
+      instant = !instant;
+      nextTurn();
+      break;
+    case '+':  // Faster
+      changeSpeed(1);
+      break;
+    case '-':  // Slower
+      changeSpeed(-1);
+      break;
+    case 'o':  // Toggle the frame profiler
+      showProfiler = !showProfiler;
+      if (profileCsv.empty()) profileCsv = "frame_profile.csv";
+      glutPostRedisplay();
+      break;
   }
 }
 
@@ -1076,56 +524,51 @@ void myreshape(int w, int h) {
 }
 
 void mymenu(int id) {
-  if (rotationcomplete == 1) {
-    rotationcomplete = 0;
-    switch (id) {
-      case 1:  // U
-        rotation = 1;
-        inverse = 0;
-        break;
-      case 2:  // R
-        rotation = 2;
-        inverse = 0;
-        break;
-
-      case 3:  // F
-        rotation = 3;
-        inverse = 0;
-        break;
-
-      case 4:  // D
-        rotation = 6;
-        inverse = 0;
-        break;
-
-      case 5:  // L
-        rotation = 4;
-        inverse = 0;
-        break;
-
-      case 6:  // B
-        rotation = 5;
-        inverse = 0;
-        break;
-
-      case 7:  // Solve
-        break;
-
-      case 8:  // Exit
-        exit(0);
-        break;
-    }
-    glutIdleFunc(spincube);
+  switch (id) {
+    case 1:  // U
+    case 2:  // R
+    case 3:  // F
+    case 4:  // D
+    case 5:  // L
+    case 6:  // B
+      queueMove(3 * (id - 1));
+      break;
+
+    case 7:  // Solve
+      startSolve();
+      break;
+
+    case 8:  // Exit
+      exit(0);
+      break;
+
+    case 9:  // Play the solution
+      playSolution();
+      break;
+
+    case 10:  // Frame profiler
+      keyboard('o', 0, 0);
+      break;
   }
 }
 
 int main(int argc, char **argv) {
-  glutInit(&argc, argv);
+  glutInit(&argc, argv);  // removes the GLUT options
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+      profileCsv = argv[++i];
+    } else {
+      std::cerr << "usage: solver-rc [GLUT options] [--profile FILE]\n"
+                   "  --profile FILE  write the frame times to FILE on exit, 'o' shows them\n";
+      return 2;
+    }
+  }
+  atexit(writeProfile);  // GLUT leaves its main loop through exit()
+  backgroundSolver.prepare();
   glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
   glutInitWindowSize(500, 500);
   glutCreateWindow("RUBIK'S CUBE");
   glutReshapeFunc(myreshape);
-  glutIdleFunc(spincube);
   glutMouseFunc(mouse);
   glutMotionFunc(motion);
   glutCreateMenu(mymenu);
@@ -1137,11 +580,14 @@ int main(int argc, char **argv) {
   glutAddMenuEntry("L - Left", 5);
   glutAddMenuEntry("B - Back", 6);
   glutAddMenuEntry("S - Solve", 7);
+  glutAddMenuEntry("P - Play solution", 9);
+  glutAddMenuEntry("O - Frame profiler", 10);
   glutAddMenuEntry("Exit", 8);
 
   glutAttachMenu(GLUT_RIGHT_BUTTON);
   glutKeyboardFunc(keyboard);
   glutDisplayFunc(display);
   glEnable(GL_DEPTH_TEST);
+  initRenderer();
   glutMainLoop();
 }
\ No newline at end of file
@@ -0,0 +1,257 @@
+#include "batch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+
+#include "twophase/cubie.hpp"
+#include "twophase/face.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::string trim(const std::string& s) {
+  size_t a = s.find_first_not_of(" \t\r"), b = s.find_last_not_of(" \t\r");
+  return a == std::string::npos ? "" : s.substr(a, b - a + 1);
+}
+
+// Parse a flat JSON object with string and number values into fields, strings are decoded. Nested values and \u
+// escapes are not supported.
+bool parse_object(const std::string& s, std::map<std::string, std::string>& fields) {
+  size_t i = 0;
+  auto skip_space = [&] {
+    while (i < s.size() && std::isspace((unsigned char)s[i])) i++;
+  };
+  auto parse_string = [&](std::string& out) {
+    if (i >= s.size() || s[i] != '"') return false;
+    for (i++; i < s.size() && s[i] != '"'; i++) {
+      if (s[i] != '\\') {
+        out += s[i];
+        continue;
+      }
+      if (++i >= s.size() || s[i] == 'u') return false;
+      out += s[i] == 'n' ? '\n' : s[i] == 't' ? '\t' : s[i] == 'r' ? '\r' : s[i];
+    }
+    if (i >= s.size()) return false;
+    i++;  // closing quote
+    return true;
+  };
+
+  skip_space();
+  if (i >= s.size() || s[i++] != '{') return false;
+  skip_space();
+  if (i < s.size() && s[i] == '}') return ++i, skip_space(), i == s.size();
+  while (true) {
+    std::string key, value;
+    skip_space();
+    if (!parse_string(key)) return false;
+    skip_space();
+    if (i >= s.size() || s[i++] != ':') return false;
+    skip_space();
+    if (i < s.size() && s[i] == '"') {
+      if (!parse_string(value)) return false;
+    } else {
+      size_t begin = i;
+      while (i < s.size() && s[i] != ',' && s[i] != '}' && !std::isspace((unsigned char)s[i])) i++;
+      value = s.substr(begin, i - begin);
+      if (value.empty()) return false;
+    }
+    fields[key] = value;
+    skip_space();
+    if (i < s.size() && s[i] == ',') {
+      i++;
+      continue;
+    }
+    if (i < s.size() && s[i] == '}') break;
+    return false;
+  }
+  i++;
+  skip_space();
+  return i == s.size();
+}
+
+bool is_cubestring(const std::string& s) {
+  return s.size() == 54 && s.find_first_not_of("URFDLB") == std::string::npos;
+}
+
+// The cube definition string of the cube after the scramble, "R U2 F' B3", or an empty string if s is not a
+// scramble.
+std::string scramble_to_cube(const std::string& s) {
+  static const std::string faces = "URFDLB";
+  twophase::CubieCube cc;
+  size_t pos = 0;
+  while (true) {
+    pos = s.find_first_not_of(" \t", pos);
+    if (pos == std::string::npos) break;
+    size_t end = std::min(s.find_first_of(" \t", pos), s.size());
+    std::string token = s.substr(pos, end - pos);
+    pos = end;
+    size_t face = faces.find(token[0]);
+    std::string power = token.substr(1);
+    int n = power == "" || power == "1" ? 1 : power == "2" || power == "2'" ? 2 : power == "3" || power == "'" ? 3 : 0;
+    if (face == std::string::npos || n == 0) return "";
+    cc.multiply(twophase::moveCube[3 * face + n - 1]);
+  }
+  return cc.to_facelet_cube().to_string();
+}
+
+BatchItem parse_item(const std::string& line, int max_length, double timeout, bool optimal) {
+  BatchItem item{"", "", "", max_length, timeout, optimal};
+  if (line[0] != '{') {
+    item.cube = is_cubestring(line) ? line : scramble_to_cube(line);
+    if (item.cube.empty()) item.error = "Error: No cube definition string or scramble.";
+    return item;
+  }
+  std::map<std::string, std::string> fields;
+  if (!parse_object(line, fields)) {
+    item.error = "Error: Invalid JSON object.";
+    return item;
+  }
+  item.id = fields["id"];
+  if (fields.count("cube")) {
+    item.cube = fields["cube"];  // validated by solve()
+  } else if (fields.count("scramble")) {
+    item.cube = scramble_to_cube(fields["scramble"]);
+    if (item.cube.empty()) item.error = "Error: Invalid scramble.";
+  } else {
+    item.error = "Error: The item has neither cube nor scramble.";
+  }
+  char* end;
+  if (fields.count("max_length")) {
+    item.max_length = int(std::strtol(fields["max_length"].c_str(), &end, 10));
+    if (*end) item.error = "Error: Invalid max_length.";
+  }
+  if (fields.count("timeout")) {
+    item.timeout = std::strtod(fields["timeout"].c_str(), &end);
+    if (*end || !(item.timeout >= 0)) item.error = "Error: Invalid timeout.";
+  }
+  if (fields.count("optimal")) item.optimal = fields["optimal"] == "true" || fields["optimal"] == "1";
+  return item;
+}
+
+struct Batch {
+  std::vector<BatchItem> items;
+  std::atomic<size_t> next = 0;  // the next item to solve
+  Clock::time_point deadline;
+  http::Disconnected disconnected;  // the client has gone, the running searches stop
+  twophase::SolveHooks hooks;
+  SolverPool* pool;
+  Metrics* metrics;
+  bool stats;  // add the stats of every solve to its line
+  std::mutex lock;  // guards done and keeps the parts of the response in order
+  size_t done = 0;
+  http::Server::Reply reply;
+};
+
+// Solve the next item of b and send its result. Returns false if all items have been taken.
+bool solve_one(Batch& b) {
+  size_t i = b.next++;
+  if (i >= b.items.size()) return false;
+  if (*b.disconnected) {  // nobody reads the result
+    b.next = b.items.size();
+    return false;
+  }
+  const BatchItem& item = b.items[i];
+  const auto start = Clock::now();
+  const double left = std::chrono::duration<double>(b.deadline - start).count();
+  std::string result = item.error;
+  if (result.empty() && left <= 0) result = "Error: Deadline exceeded.";
+  twophase::SolveStats stats;
+  bool searched = result.empty();
+  if (searched) {
+    double timeout = std::min(item.timeout, left);
+    twophase::SolveHooks hooks = b.hooks;
+    hooks.stats = &stats;
+    hooks.deadline = left;  // the search returns its best solution at the deadline of the batch
+    result = item.optimal ? twophase::solve_optimal(item.cube, timeout, hooks)
+                          : twophase::solve(item.cube, item.max_length, timeout, hooks);
+    if (result == twophase::NO_SOLUTION_YET) result = "Error: Deadline exceeded.";
+    b.metrics->solve(stats, item.optimal, !result.starts_with("Error"),
+                     std::chrono::duration<double>(Clock::now() - start).count());
+  }
+
+  std::string line = "{\"index\": " + std::to_string(i);
+  if (!item.id.empty()) line += ", \"id\": " + json_string(item.id);
+  if (result.starts_with("Error")) {
+    line += ", \"error\": " + json_string(result);
+  } else {
+    size_t paren = result.rfind('(');
+    line += ", \"solution\": " + json_string(result) + ", \"length\": " + std::to_string(std::atoi(&result[paren + 1]));
+  }
+  char time[40];
+  std::snprintf(time, sizeof(time), ", \"time\": %.4f", std::chrono::duration<double>(Clock::now() - start).count());
+  line += time;
+  if (b.stats && searched) line += ", \"stats\": " + stats_json(stats);
+  line += "}\n";
+
+  std::lock_guard guard(b.lock);
+  bool last = ++b.done == b.items.size();
+  b.reply({200, line, "application/x-ndjson", !last});
+  return true;
+}
+
+// Solve the items of b one by one, each time queued again behind the jobs waiting in the pool. If the queue is full
+// this thread goes on with the next item.
+void runner(const std::shared_ptr<Batch>& b) {
+  while (solve_one(*b))
+    if (b->pool->submit([b] { runner(b); })) return;
+}
+
+}  // namespace
+
+std::string json_string(const std::string& s) {
+  std::string ret = "\"";
+  for (char ch : s) {
+    if (ch == '"' || ch == '\\') {
+      ret += '\\';
+      ret += ch;
+    } else if ((unsigned char)ch < 0x20) {
+      char esc[8];
+      std::snprintf(esc, sizeof(esc), "\\u%04x", ch);
+      ret += esc;
+    } else {
+      ret += ch;
+    }
+  }
+  return ret + "\"";
+}
+
+std::vector<BatchItem> parse_batch(const std::string& body, int max_length, double timeout, bool optimal) {
+  std::vector<BatchItem> items;
+  size_t pos = 0;
+  while (pos < body.size()) {
+    size_t end = std::min(body.find('\n', pos), body.size());
+    std::string line = trim(body.substr(pos, end - pos));
+    if (!line.empty()) items.push_back(parse_item(line, max_length, timeout, optimal));
+    pos = end + 1;
+  }
+  return items;
+}
+
+void run_batch(SolverPool& pool, std::vector<BatchItem> items, double deadline, const twophase::SolveHooks& hooks,
+               Metrics& metrics, bool stats, http::Disconnected disconnected, http::Server::Reply reply) {
+  if (items.empty()) return reply({200, "", "application/x-ndjson"});
+  auto b = std::make_shared<Batch>();
+  b->items = std::move(items);
+  b->deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(deadline));
+  b->hooks = hooks;
+  b->hooks.cancel = disconnected.get();
+  b->hooks.improved = nullptr;
+  b->pool = &pool;
+  b->metrics = &metrics;
+  b->stats = stats;
+  b->disconnected = std::move(disconnected);
+  b->reply = std::move(reply);
+  size_t runners = std::min(pool.size(), b->items.size()), started = 0;
+  for (size_t i = 0; i < runners; i++) started += pool.submit([b] { runner(b); });
+  if (started == 0) {
+    b->next = b->items.size();  // nothing of the response has been sent yet
+    b->reply({503, "Too many solves waiting"});
+  }
+}
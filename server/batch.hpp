@@ -0,0 +1,41 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "http.hpp"
+#include "metrics.hpp"
+#include "solver_pool.hpp"
+#include "twophase/solver.hpp"
+
+// Batch solves of POST /solve. The body holds one item per line: a cube definition string, a scramble like
+// "R U2 F' B3", or a JSON object {"id": "a1", "cube": "...", "scramble": "...", "max_length": 20, "timeout": 3} with
+// either cube or scramble. "optimal": true asks for a shortest maneuver, max_length does not apply then. The items run
+// on the SolverPool and every result is streamed as one JSON line as soon as it is found,
+// {"index": 0, "id": "a1", "solution": "U1 R2 (2f)", "length": 2, "time": 0.012} or with "error" instead of solution
+// and length. Items not solved by the deadline of the request are answered with an error. With stats
+// every line has the "stats" of its solve as well, see stats_json().
+
+struct BatchItem {
+  std::string id;  // echoed in the result
+  std::string cube;  // cube definition string
+  std::string error;  // the line is not a valid item
+  int max_length;
+  double timeout;
+  bool optimal;  // solve_optimal() instead of solve()
+};
+
+// Parse the body of a batch request, empty lines are skipped. max_length, timeout and optimal are the defaults of the
+// items.
+std::vector<BatchItem> parse_batch(const std::string& body, int max_length, double timeout, bool optimal);
+
+// Solve the items on pool, up to one item per pool thread at a time. Every item is queued behind the waiting jobs
+// of the pool, so a large batch does not delay the single solves for long. Answers through reply, streamed. The
+// solves are added to metrics. A search running at the deadline returns its best solution, items without one and
+// items still waiting get an error. Once disconnected is set the running searches are cancelled and the remaining
+// items are skipped.
+void run_batch(SolverPool& pool, std::vector<BatchItem> items, double deadline, const twophase::SolveHooks& hooks,
+               Metrics& metrics, bool stats, http::Disconnected disconnected, http::Server::Reply reply);
+
+// s as a JSON string literal.
+std::string json_string(const std::string& s);
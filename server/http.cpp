@@ -0,0 +1,462 @@
+#include "http.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace http {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint64_t LISTEN_ID = 0, WAKE_ID = 1, UNIX_ID = 2;  // epoll ids of the listening sockets and of the eventfd
+constexpr size_t MAX_HEADER = 16 * 1024;
+constexpr size_t MAX_BODY = 1024 * 1024;
+constexpr auto IDLE_TIMEOUT = std::chrono::seconds(60);
+
+const char* status_text(int status) {
+  switch (status) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 413: return "Payload Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+  }
+}
+
+std::string lower(std::string s) {
+  for (char& ch : s) ch = char(std::tolower((unsigned char)ch));
+  return s;
+}
+
+std::string trim(const std::string& s) {
+  size_t a = s.find_first_not_of(" \t"), b = s.find_last_not_of(" \t");
+  return a == std::string::npos ? "" : s.substr(a, b - a + 1);
+}
+
+// Decode %xx and + of a query string component.
+std::string url_decode(const std::string& s) {
+  std::string ret;
+  for (size_t i = 0; i < s.size(); i++) {
+    if (s[i] == '+') {
+      ret += ' ';
+    } else if (s[i] == '%' && i + 2 < s.size() && std::isxdigit((unsigned char)s[i + 1]) &&
+               std::isxdigit((unsigned char)s[i + 2])) {
+      ret += char(std::stoi(s.substr(i + 1, 2), nullptr, 16));
+      i += 2;
+    } else {
+      ret += s[i];
+    }
+  }
+  return ret;
+}
+
+std::map<std::string, std::string> parse_query(const std::string& q) {
+  std::map<std::string, std::string> ret;
+  size_t pos = 0;
+  while (pos <= q.size()) {
+    size_t end = std::min(q.find('&', pos), q.size());
+    std::string item = q.substr(pos, end - pos);
+    if (!item.empty()) {
+      size_t eq = item.find('=');
+      std::string value = eq == std::string::npos ? "" : url_decode(item.substr(eq + 1));
+      ret.emplace(url_decode(item.substr(0, eq)), std::move(value));  // the first value wins like parse_qs(...)[0]
+    }
+    pos = end + 1;
+  }
+  return ret;
+}
+
+std::string format(const Response& r, bool keep_alive) {
+  std::string s = "HTTP/1.1 " + std::to_string(r.status) + " " + status_text(r.status) + "\r\n";
+  s += "Content-Type: " + r.content_type + "\r\n";
+  s += "Content-Length: " + std::to_string(r.body.size()) + "\r\n";
+  if (!keep_alive) s += "Connection: close\r\n";
+  s += "\r\n";
+  return s + r.body;
+}
+
+// Head of a streamed response. HTTP/1.0 clients do not know chunks, for them the end of the body is the end of the
+// connection.
+std::string format_stream_head(const Response& r, bool chunked, bool keep_alive) {
+  std::string s = "HTTP/1.1 " + std::to_string(r.status) + " " + status_text(r.status) + "\r\n";
+  s += "Content-Type: " + r.content_type + "\r\n";
+  if (chunked) s += "Transfer-Encoding: chunked\r\n";
+  if (!keep_alive) s += "Connection: close\r\n";
+  return s + "\r\n";
+}
+
+std::string format_chunk(const std::string& data) {
+  char size[20];
+  std::snprintf(size, sizeof(size), "%zx\r\n", data.size());
+  return size + data + "\r\n";
+}
+
+}  // namespace
+
+struct Server::Connection {
+  int fd;
+  uint64_t id;
+  bool raw;  // binary protocol of the Unix domain socket
+  std::string state;  // of the RawHandler
+  std::string in, out;
+  bool waiting = false;  // the handler has not replied yet, the following requests wait
+  bool keep_alive = true;  // of the request being answered
+  bool chunked = true;  // the request being answered is HTTP/1.1, a streamed response is sent in chunks
+  bool streaming = false;  // the head and some parts of a streamed response have been sent
+  bool closing = false;  // close as soon as out has been written
+  bool peer_closed = false;  // the client has shut down its side, no more requests follow
+  std::shared_ptr<std::atomic<bool>> disconnected = std::make_shared<std::atomic<bool>>(false);
+  uint32_t events = 0;  // registered with epoll
+  Clock::time_point last_active = Clock::now();
+};
+
+Server::Server(int port, Handler handler) : handler(std::move(handler)) {
+  listen_fd = ::socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listen_fd < 0) throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+  int on = 1, off = 0;
+  ::setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  ::setsockopt(listen_fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));  // IPv4 clients too
+  sockaddr_in6 addr{};
+  addr.sin6_family = AF_INET6;
+  addr.sin6_addr = in6addr_any;
+  addr.sin6_port = htons(uint16_t(port));
+  if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      ::listen(listen_fd, SOMAXCONN) != 0) {
+    std::string err = std::strerror(errno);
+    ::close(listen_fd);
+    throw std::runtime_error("cannot listen on port " + std::to_string(port) + ": " + err);
+  }
+  epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+  wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.u64 = LISTEN_ID;
+  ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+  ev.data.u64 = WAKE_ID;
+  ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+  next_id = UNIX_ID + 1;
+}
+
+void Server::listen_unix(const std::string& path, RawParser parse, RawHandler handle) {
+  sockaddr_un addr{};
+  if (path.size() >= sizeof(addr.sun_path)) throw std::runtime_error("socket path too long: " + path);
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+  unix_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (unix_fd < 0) throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+  ::unlink(path.c_str());  // left behind by a server which has not exited cleanly
+  if (::bind(unix_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(unix_fd, SOMAXCONN) != 0) {
+    std::string err = std::strerror(errno);
+    ::close(unix_fd);
+    unix_fd = -1;
+    throw std::runtime_error("cannot listen on " + path + ": " + err);
+  }
+  unix_path = path;
+  raw_parser = std::move(parse);
+  raw_handler = std::move(handle);
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.u64 = UNIX_ID;
+  ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, unix_fd, &ev);
+}
+
+Server::~Server() {
+  for (auto& [id, c] : connections) ::close(c->fd);
+  ::close(listen_fd);
+  if (unix_fd >= 0) {
+    ::close(unix_fd);
+    ::unlink(unix_path.c_str());
+  }
+  ::close(epoll_fd);
+  ::close(wake_fd);
+}
+
+void Server::stop() {
+  stopping = true;
+  uint64_t one = 1;
+  [[maybe_unused]] ssize_t n = ::write(wake_fd, &one, sizeof(one));
+}
+
+void Server::run() {
+  std::vector<epoll_event> events(256);
+  auto last_idle_check = Clock::now();
+  loop_thread = std::this_thread::get_id();
+  while (!stopping) {
+    int n = ::epoll_wait(epoll_fd, events.data(), int(events.size()), 1000);
+    if (n < 0 && errno != EINTR) throw std::runtime_error(std::string("epoll_wait: ") + std::strerror(errno));
+    for (int i = 0; i < n; i++) {
+      uint64_t id = events[i].data.u64;
+      if (id == LISTEN_ID) {
+        accept_connections(listen_fd, false);
+      } else if (id == UNIX_ID) {
+        accept_connections(unix_fd, true);
+      } else if (id == WAKE_ID) {
+        uint64_t count;
+        [[maybe_unused]] ssize_t r = ::read(wake_fd, &count, sizeof(count));
+      } else {
+        auto it = connections.find(id);
+        if (it == connections.end()) continue;  // closed by an earlier event of this round
+        Connection& c = *it->second;
+        if (events[i].events & EPOLLOUT) {
+          write_to(c);
+          if (!connections.count(id)) continue;
+        }
+        if (!(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR | EPOLLRDHUP))) continue;
+        if (c.peer_closed) close_connection(id);  // only HUP or ERR are left, the connection has been reset
+        else read_from(c);
+      }
+    }
+    complete_replies();
+    if (Clock::now() - last_idle_check > std::chrono::seconds(1)) {
+      close_idle();
+      if (tick) tick();
+      last_idle_check = Clock::now();
+    }
+  }
+  std::vector<uint64_t> ids;
+  for (auto& [id, c] : connections) ids.push_back(id);
+  for (uint64_t id : ids) close_connection(id);  // cancels the requests still being answered
+}
+
+void Server::accept_connections(int listener, bool raw) {
+  while (true) {
+    int fd = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) return;  // EAGAIN, or out of file descriptors until a connection closes
+    int on = 1;
+    if (!raw) ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));  // small responses, do not wait for more
+    auto c = std::make_unique<Connection>();
+    c->fd = fd;
+    c->id = next_id++;
+    c->raw = raw;
+    c->events = EPOLLIN | EPOLLRDHUP;
+    epoll_event ev{};
+    ev.events = c->events;
+    ev.data.u64 = c->id;
+    ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    connections.emplace(c->id, std::move(c));
+  }
+}
+
+void Server::read_from(Connection& c) {
+  char buf[16 * 1024];
+  while (true) {
+    ssize_t n = ::recv(c.fd, buf, sizeof(buf), 0);
+    if (n > 0) {
+      c.in.append(buf, size_t(n));
+      c.last_active = Clock::now();
+      if (c.in.size() > MAX_HEADER + MAX_BODY) break;  // the rest waits until the pending requests are answered
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    if (n == 0) {  // shut down by the peer, e.g. nc -N or a HTTP/1.0 tool, the requests read so far are answered
+      c.peer_closed = true;
+      break;
+    }
+    close_connection(c.id);  // error, a pending reply is dropped
+    return;
+  }
+  handle_requests(c);
+}
+
+void Server::push_reply(uint64_t id, Response r) {
+  {
+    std::lock_guard guard(replies_lock);
+    replies.emplace_back(id, std::move(r));
+  }
+  if (std::this_thread::get_id() == loop_thread) return;  // complete_replies() runs before the loop waits again
+  uint64_t one = 1;
+  [[maybe_unused]] ssize_t n = ::write(wake_fd, &one, sizeof(one));
+}
+
+void Server::handle_requests(Connection& c) {
+  if (c.raw) return handle_raw_requests(c);
+  const uint64_t id = c.id;
+  while (!c.waiting && !c.closing) {
+    size_t header_end = c.in.find("\r\n\r\n");
+    if (header_end == std::string::npos) {
+      if (c.in.size() > MAX_HEADER) {
+        c.out += format({431, "Request header too large"}, false);
+        c.closing = true;
+      }
+      break;
+    }
+    Request req;
+    std::vector<std::string> lines;
+    for (size_t pos = 0; pos < header_end;) {
+      size_t end = std::min(c.in.find("\r\n", pos), header_end);
+      lines.push_back(c.in.substr(pos, end - pos));
+      pos = end + 2;
+    }
+    std::string target, version;
+    {
+      const std::string& line = lines.empty() ? std::string() : lines[0];
+      size_t a = line.find(' '), b = line.rfind(' ');
+      if (a == std::string::npos || b <= a) {
+        c.out += format({400, "Bad request line"}, false);
+        c.closing = true;
+        break;
+      }
+      req.method = line.substr(0, a);
+      target = line.substr(a + 1, b - a - 1);
+      version = line.substr(b + 1);
+    }
+    for (size_t i = 1; i < lines.size(); i++) {
+      size_t colon = lines[i].find(':');
+      if (colon == std::string::npos) continue;
+      req.headers[lower(trim(lines[i].substr(0, colon)))] = trim(lines[i].substr(colon + 1));
+    }
+    size_t body_len = 0;
+    if (auto it = req.headers.find("content-length"); it != req.headers.end())
+      body_len = std::strtoull(it->second.c_str(), nullptr, 10);
+    if (req.headers.count("transfer-encoding") || body_len > MAX_BODY) {
+      c.out += format({body_len > MAX_BODY ? 413 : 501, "Unsupported request body"}, false);
+      c.closing = true;
+      break;
+    }
+    if (c.in.size() < header_end + 4 + body_len) break;  // wait for the rest of the body
+    req.body = c.in.substr(header_end + 4, body_len);
+    c.in.erase(0, header_end + 4 + body_len);
+
+    size_t qmark = target.find('?');
+    req.path = target.substr(0, qmark);
+    if (qmark != std::string::npos) req.query = parse_query(target.substr(qmark + 1));
+    std::string connection = lower(req.headers["connection"]);
+    c.keep_alive = version == "HTTP/1.1" ? connection != "close" : connection == "keep-alive";
+    c.chunked = version == "HTTP/1.1";
+    c.waiting = true;
+    req.disconnected = c.disconnected;
+
+    handler(req, [this, id](Response r) { push_reply(id, std::move(r)); });
+  }
+  if (c.peer_closed && !c.waiting) c.closing = true;  // no complete request is left
+  if (connections.count(id)) write_to(c);
+}
+
+void Server::handle_raw_requests(Connection& c) {
+  const uint64_t id = c.id;
+  size_t pos = 0;
+  while (!c.waiting && !c.closing && pos < c.in.size()) {
+    size_t n = raw_parser(std::string_view(c.in).substr(pos));
+    if (n == 0) break;
+    if (n == std::string::npos) {
+      c.closing = true;
+      break;
+    }
+    c.waiting = true;
+    auto reply = [this, id](Response r) { push_reply(id, std::move(r)); };
+    raw_handler(c.state, std::string_view(c.in).substr(pos, n), reply, c.disconnected);
+    pos += n;
+  }
+  c.in.erase(0, pos);
+  if (c.peer_closed && !c.waiting) c.closing = true;  // no complete request is left
+  if (connections.count(id)) write_to(c);
+}
+
+void Server::complete_replies() {
+  while (true) {
+    std::pair<uint64_t, Response> reply;
+    {
+      std::lock_guard guard(replies_lock);
+      if (replies.empty()) return;
+      reply = std::move(replies.front());
+      replies.pop_front();
+    }
+    auto it = connections.find(reply.first);
+    if (it == connections.end()) continue;  // the client has gone
+    Connection& c = *it->second;
+    const Response& r = reply.second;
+    if (c.raw) {
+      c.out += r.body;
+      if (r.more) {
+        write_to(c);
+        continue;
+      }
+    } else if (r.more || c.streaming) {
+      if (!c.chunked) c.keep_alive = false;
+      if (!c.streaming) c.out += format_stream_head(r, c.chunked, c.keep_alive);
+      c.streaming = r.more;
+      if (!r.body.empty()) c.out += c.chunked ? format_chunk(r.body) : r.body;
+      if (r.more) {
+        write_to(c);  // the request is still being answered
+        continue;
+      }
+      if (c.chunked) c.out += "0\r\n\r\n";
+    } else {
+      c.out += format(r, c.keep_alive);
+    }
+    c.waiting = false;
+    if (!c.keep_alive) c.closing = true;
+    handle_requests(c);  // pipelined requests, writes the output
+  }
+}
+
+void Server::write_to(Connection& c) {
+  while (!c.out.empty()) {
+    ssize_t n = ::send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+    if (n > 0) {
+      c.out.erase(0, size_t(n));
+      c.last_active = Clock::now();
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    close_connection(c.id);
+    return;
+  }
+  if (c.out.empty() && c.closing) {
+    close_connection(c.id);
+    return;
+  }
+  update_events(c);
+}
+
+void Server::update_events(Connection& c) {
+  uint32_t events = c.peer_closed ? 0u : uint32_t(EPOLLRDHUP);  // HUP and ERR are always reported
+  if (!c.out.empty()) events |= EPOLLOUT;
+  if (c.in.size() <= MAX_HEADER + MAX_BODY && !c.closing && !c.peer_closed) events |= EPOLLIN;
+  if (events == c.events) return;
+  c.events = events;
+  epoll_event ev{};
+  ev.events = events;
+  ev.data.u64 = c.id;
+  ::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c.fd, &ev);
+}
+
+void Server::close_connection(uint64_t id) {
+  auto it = connections.find(id);
+  if (it == connections.end()) return;
+  *it->second->disconnected = true;
+  ::close(it->second->fd);  // also removes it from the epoll set
+  connections.erase(it);
+}
+
+void Server::close_idle() {
+  const auto now = Clock::now();
+  std::vector<uint64_t> idle;
+  for (auto& [id, c] : connections)
+    if (!c->waiting && c->out.empty() && now - c->last_active > IDLE_TIMEOUT) idle.push_back(id);
+  for (uint64_t id : idle) close_connection(id);
+}
+
+}  // namespace http
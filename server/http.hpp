@@ -0,0 +1,108 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+// Minimal HTTP/1.1 server on an epoll event loop. One thread runs the loop, it parses the requests, calls the handler
+// and writes the responses. Connections are kept alive, several requests of one connection are answered in order. A
+// handler answers through a Reply, which may be called later from any thread, so long running requests are handed to
+// other threads and never block the loop. A response may be streamed in parts, sent with chunked transfer encoding.
+// The same loop may also serve a binary protocol on a Unix domain socket, see listen_unix().
+//
+// A client may shut down its side of the connection after its requests, they are still answered. A connection which
+// fails or is reset, or any connection when the server stops, sets its Disconnected flag, so that the work of its
+// pending requests can be cancelled.
+
+namespace http {
+
+// Set when the connection of a request is closed, a response which has not been sent can no longer be delivered.
+using Disconnected = std::shared_ptr<const std::atomic<bool>>;
+
+struct Request {
+  std::string method;
+  std::string path;  // without the query
+  std::map<std::string, std::string> query;  // decoded parameters of the query string
+  std::map<std::string, std::string> headers;  // names in lower case
+  std::string body;
+  Disconnected disconnected;
+};
+
+struct Response {
+  int status = 200;
+  std::string body;
+  std::string content_type = "text/plain";
+  // The body is only a part of a streamed response, more parts follow in further calls of the Reply. Status and
+  // content type of the first part count, the response ends with the first part without more.
+  bool more = false;
+};
+
+class Server {
+public:
+  // Sends the response of one request. Must be called exactly once, from any thread, or several times for a streamed
+  // response with Response::more. The calls for one request must not overlap.
+  using Reply = std::function<void(Response)>;
+  using Handler = std::function<void(const Request&, Reply)>;
+  // Length of the first request of a binary protocol at the start of in, 0 if it is incomplete, std::string::npos if
+  // in is invalid and the connection has to be closed.
+  using RawParser = std::function<size_t(std::string_view in)>;
+  // Answers a request of a binary protocol with the bytes of Response::body, an empty body sends nothing. state
+  // belongs to the connection, it starts empty and is kept for the handler, e.g. the session of the client. request is
+  // only valid during the call.
+  using RawHandler = std::function<void(std::string& state, std::string_view request, Reply, Disconnected)>;
+
+  // Listen on port of all interfaces. Throws std::runtime_error if the port cannot be bound.
+  Server(int port, Handler handler);
+  ~Server();
+  Server(const Server&) = delete;
+  Server& operator=(const Server&) = delete;
+
+  // Also accept connections on the Unix domain socket path, a stale socket file is replaced and the file is removed
+  // again by the destructor. Its requests are cut by parse and answered by handle in order. Call before run(). Throws
+  // std::runtime_error if path cannot be bound.
+  void listen_unix(const std::string& path, RawParser parse, RawHandler handle);
+
+  // Run the event loop until stop() is called, then close all connections.
+  void run();
+  // May be called from any thread and from signal handlers.
+  void stop();
+  // Call f on the event loop about once a second, e.g. to drop expired state. Set before run().
+  void every_second(std::function<void()> f) { tick = std::move(f); }
+
+private:
+  struct Connection;
+
+  void accept_connections(int fd, bool raw);
+  void read_from(Connection& c);
+  void handle_requests(Connection& c);
+  void handle_raw_requests(Connection& c);
+  void push_reply(uint64_t id, Response r);
+  void write_to(Connection& c);
+  void complete_replies();
+  void close_connection(uint64_t id);
+  void close_idle();
+  void update_events(Connection& c);
+
+  Handler handler;
+  RawParser raw_parser;
+  RawHandler raw_handler;
+  std::string unix_path;
+  std::function<void()> tick;
+  std::atomic<bool> stopping = false;
+  std::thread::id loop_thread;  // replies from the loop itself need no wakeup
+  int listen_fd = -1, unix_fd = -1, epoll_fd = -1, wake_fd = -1;
+  uint64_t next_id = 1;  // connection ids are never reused, a late reply to a closed connection is dropped
+  std::unordered_map<uint64_t, std::unique_ptr<Connection>> connections;
+
+  std::mutex replies_lock;  // guards replies, written by the Reply functions
+  std::deque<std::pair<uint64_t, Response>> replies;
+};
+
+}  // namespace http
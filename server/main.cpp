@@ -0,0 +1,315 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "batch.hpp"
+#include "http.hpp"
+#include "metrics.hpp"
+#include "protocol.hpp"
+#include "sessions.hpp"
+#include "speculation.hpp"
+#include "solver_pool.hpp"
+#include "twophase/cache.hpp"
+#include "twophase/solver.hpp"
+
+// Native replacement of kociemba/server.py with the same /move, /state and /solve endpoints. The event loop answers
+// /move and /state at once, the solves run on the SolverPool and are answered when they are done.
+//
+// GET /solve?optimal=1&timeout=60 searches a shortest maneuver of the cube instead, see solve_optimal().
+// GET /solve?deadline=0.5 answers after at most 0.5 seconds of search, with twophase::NO_SOLUTION_YET if none has been
+// found by then. Without it a solve goes on past its timeout until it has a solution.
+//
+// POST /solve?max_length=20&timeout=3&deadline=60&optimal=0 is stateless, it solves the cubes in the body and streams
+// the results as JSON lines, see batch.hpp.
+//
+// Every client has its own cube, chosen by the session parameter: /move?session=abc&move=urf. Requests without a
+// session share the cube of the session "default", like all clients of server.py do.
+//
+// Every /move starts a speculative solve of the new state in the background, see speculation.hpp. A /solve which finds
+// a speculative solution of SOLVE_MAX_LENGTH moves or less returns it without waiting for a search.
+//
+// GET /metrics has the counters of the server and of the search in the Prometheus text format, see metrics.hpp.
+// GET /solve?stats=1 answers with a JSON object of the solution and the statistics of its search.
+//
+// Clients on the same host may use the binary protocol of protocol.hpp on a Unix domain socket instead, served by the
+// same event loop.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Longest solution GET /solve accepts, and its timeout, like server.py.
+constexpr int SOLVE_MAX_LENGTH = 25;
+constexpr double SOLVE_TIMEOUT = 1;
+// The speculative solves look for shorter solutions, any solution they keep answers a /solve.
+constexpr int SPECULATE_MAX_LENGTH = 20;
+
+void usage() {
+  std::fprintf(stderr,
+               "usage: cube-server [options]\n"
+               "  -p, --port N        port to run the server on (default 8081, where the client reports its moves)\n"
+               "  -s, --solvers N     solves running at the same time (default 2)\n"
+               "  -t, --threads N     threads of the search pool shared by all solves (default: hardware threads)\n"
+               "  -m, --max-memory N  megabytes for the sessions, the least recently used are dropped (default 256)\n"
+               "  -i, --idle N        drop sessions without requests for N seconds (default 3600)\n"
+               "  -c, --cache N       solutions kept for repeated and symmetric positions, 0: none (default 100000)\n"
+               "  --cache-file FILE   load the solutions from FILE and store them there on exit\n"
+               "  -S, --speculate N   seconds of the background solve after every move, 0: none (default 3)\n"
+               "  -u, --unix PATH     also serve the binary protocol on this Unix socket, \"\": none (default %s)\n",
+               proto::DEFAULT_PATH);
+  std::exit(2);
+}
+
+http::Server* server = nullptr;
+
+void on_signal(int) { server->stop(); }
+
+// The session of a request, empty if the session parameter is invalid.
+std::string session_of(const http::Request& req) {
+  auto it = req.query.find("session");
+  if (it == req.query.end()) return "default";
+  return SessionStore::valid_id(it->second) ? it->second : "";
+}
+
+http::Response handle_move(SessionStore& sessions, const http::Request& req) {
+  std::string session = session_of(req);
+  if (session.empty()) return {400, "Invalid session"};
+  auto it = req.query.find("move");
+  if (it == req.query.end()) return {400, "Missing move parameter"};
+  // One or more moves, the client batches the moves which piled up: move=urf
+  static const std::string faces = "urfdlb";
+  std::vector<uint8_t> moves;
+  for (char ch : it->second) {
+    size_t face = faces.find(char(std::tolower((unsigned char)ch)));
+    if (face == std::string::npos) return {400, "Invalid move"};
+    moves.push_back(uint8_t(3 * face));  // quarter turn clockwise
+  }
+  if (moves.empty()) return {400, "Invalid move"};
+  return {200, sessions.apply(session, moves.data(), moves.size()).to_string()};
+}
+
+// Label of the request in the metrics, a fixed set of names.
+std::string endpoint_of(const http::Request& req) {
+  if (req.method == "POST" && req.path == "/solve") return "/solve batch";
+  if (req.method == "GET" && (req.path == "/move" || req.path == "/state" || req.path == "/solve" ||
+                              req.path == "/metrics"))
+    return req.path;
+  return "other";
+}
+
+// Answer of GET /solve with stats=1, stats is null if the solution has been found without a search.
+std::string solve_json(const std::string& solution, twophase::SolveStats* stats) {
+  return "{\"solution\": " + json_string(solution) + ", \"stats\": " + (stats ? stats_json(*stats) : "null") + "}\n";
+}
+
+// Requests of the binary protocol, a SESSION request with an invalid id closes the connection.
+size_t binary_request_size(std::string_view in) {
+  size_t n = proto::request_size(in);
+  if (n == 0 || n == std::string::npos || uint8_t(in[0]) != proto::SESSION) return n;
+  return SessionStore::valid_id(std::string(in.substr(2, n - 2))) ? n : std::string::npos;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int port = 8081, solvers = 2, threads = 0, max_memory = 256, idle = 3600, cache_size = 100000, speculate = 3;
+  std::string cache_file, unix_path = proto::DEFAULT_PATH;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto value = [&] {
+      if (i + 1 >= argc) usage();
+      return std::atoi(argv[++i]);
+    };
+    if (arg == "-p" || arg == "--port") port = value();
+    else if (arg == "-s" || arg == "--solvers") solvers = std::max(1, value());
+    else if (arg == "-t" || arg == "--threads") threads = value();
+    else if (arg == "-m" || arg == "--max-memory") max_memory = std::max(1, value());
+    else if (arg == "-i" || arg == "--idle") idle = std::max(1, value());
+    else if (arg == "-c" || arg == "--cache") cache_size = std::max(0, value());
+    else if (arg == "--cache-file" && i + 1 < argc) cache_file = argv[++i];
+    else if (arg == "-S" || arg == "--speculate") speculate = std::max(0, value());
+    else if ((arg == "-u" || arg == "--unix") && i + 1 < argc) unix_path = argv[++i];
+    else usage();
+  }
+
+  if (threads > 0) twophase::set_threads(threads);
+  twophase::init();  // create or map the tables before the first request
+  auto pool = std::make_unique<SolverPool>(solvers, 64 * size_t(solvers));
+  const size_t max_sessions = (size_t(max_memory) << 20) / SessionStore::BYTES_PER_SESSION;
+  SessionStore sessions(max_sessions, std::chrono::seconds(idle));
+  std::unique_ptr<twophase::SolutionCache> cache;
+  if (cache_size > 0) cache = std::make_unique<twophase::SolutionCache>(cache_size, cache_file);
+  twophase::SolveHooks hooks;
+  hooks.cache = cache.get();
+  std::unique_ptr<Speculator> speculator;
+  if (speculate > 0)
+    speculator = std::make_unique<Speculator>(solvers, SPECULATE_MAX_LENGTH, speculate, max_sessions,
+                                              std::chrono::seconds(idle), hooks);
+
+  Metrics metrics;
+
+  // Solve state with solve(), or with solve_optimal() if optimal, on the pool and add the solve to the metrics. done
+  // gets the result and the statistics of the search. deadline is twophase::SolveHooks::deadline, counted from the
+  // start of the search. The search is skipped or cancelled once the connection of the request has been closed.
+  // Returns false if too many solves are waiting.
+  using Done = std::function<void(const std::string&, twophase::SolveStats*)>;
+  auto submit_solve = [&](const std::string& state, bool optimal, double timeout, double deadline,
+                          http::Disconnected disconnected, Done done) {
+    return pool->submit([state, optimal, timeout, deadline, disconnected, done, &hooks, &metrics] {
+      if (*disconnected) return;  // nobody waits for the result
+      twophase::SolveStats stats;
+      twophase::SolveHooks h = hooks;
+      h.stats = &stats;
+      h.deadline = deadline;
+      h.cancel = disconnected.get();
+      const auto start = Clock::now();
+      std::string solution = optimal ? twophase::solve_optimal(state, timeout, h)
+                                     : twophase::solve(state, SOLVE_MAX_LENGTH, timeout, h);
+      metrics.solve(stats, optimal, !solution.starts_with("Error"),
+                    std::chrono::duration<double>(Clock::now() - start).count());
+      done(solution, &stats);
+    });
+  };
+  // Solve the cube of session in state, answered by the speculative solves if they have found a solution.
+  auto solve_cube = [&](const std::string& session, const std::string& state, double deadline,
+                        http::Disconnected disconnected, Done done) {
+    if (speculator) {
+      std::string solution = speculator->result(session, state, SOLVE_MAX_LENGTH);
+      if (!solution.empty()) return done(solution, nullptr), true;
+    }
+    return submit_solve(state, false, SOLVE_TIMEOUT, deadline, disconnected, done);
+  };
+
+  http::Server srv(port, [&](const http::Request& req, http::Server::Reply reply) {
+    reply = [reply, &metrics, endpoint = endpoint_of(req), start = Clock::now()](http::Response r) {
+      if (!r.more) metrics.request(endpoint, r.status, std::chrono::duration<double>(Clock::now() - start).count());
+      reply(std::move(r));
+    };
+    if (req.method == "POST" && req.path == "/solve") {
+      auto param = [&req](const char* name, double def) {
+        auto it = req.query.find(name);
+        return it == req.query.end() ? def : std::atof(it->second.c_str());
+      };
+      auto items = parse_batch(req.body, int(param("max_length", 20)), param("timeout", 3), param("optimal", 0) != 0);
+      return run_batch(*pool, std::move(items), param("deadline", 60), hooks, metrics, param("stats", 0) != 0,
+                       req.disconnected, reply);
+    }
+    if (req.method != "GET") return reply({501, "Unsupported method (" + req.method + ")"});
+    if (req.path == "/metrics") {
+      std::string body = metrics.render();
+      body += metric("cube_server_sessions", "gauge", "Sessions with a cube.", double(sessions.size()));
+      if (cache) {
+        twophase::SolutionCache::Counters c = cache->counters();
+        body += metric("twophase_cache_hits_total", "counter", "Solves answered by the cache.", double(c.hits));
+        body += metric("twophase_cache_misses_total", "counter", "Solves not in the cache.", double(c.misses));
+        body += metric("twophase_cache_evictions_total", "counter", "Solutions dropped from the cache.",
+                       double(c.evictions));
+        body += metric("twophase_cache_solutions", "gauge", "Solutions in the cache.", double(c.size));
+      }
+      if (speculator) {
+        Speculator::Counters c = speculator->counters();
+        body += metric("cube_server_speculative_solves_total", "counter", "Background solves started after a move.",
+                       double(c.started));
+        body += metric("cube_server_speculative_cancelled_total", "counter", "Background solves cancelled by a move.",
+                       double(c.cancelled));
+        body += metric("cube_server_speculative_hits_total", "counter", "Solves answered by a background solve.",
+                       double(c.hits));
+        body += metric("cube_server_speculative_misses_total", "counter", "Solves without a background solution.",
+                       double(c.misses));
+      }
+      return reply({200, body, "text/plain; version=0.0.4"});
+    }
+    if (req.path == "/move") {
+      http::Response res = handle_move(sessions, req);
+      if (res.status == 200 && speculator) speculator->moved(session_of(req), res.body);
+      return reply(res);
+    }
+    if (req.path == "/state" || req.path == "/solve") {
+      std::string session = session_of(req);
+      if (session.empty()) return reply({400, "Invalid session"});
+      std::string state = sessions.state(session);
+      if (req.path == "/state") return reply({200, state});
+      auto flag = [&req](const char* name) {
+        auto it = req.query.find(name);
+        return it != req.query.end() && (it->second == "1" || it->second == "true");
+      };
+      Done done = [reply, with_stats = flag("stats")](const std::string& solution, twophase::SolveStats* stats) {
+        if (with_stats) reply({200, solve_json(solution, stats), "application/json"});
+        else reply({200, solution});
+      };
+      auto number = [&req](const char* name, double def) {
+        auto it = req.query.find(name);
+        return it == req.query.end() ? def : std::atof(it->second.c_str());
+      };
+      const double deadline = std::max(0.0, number("deadline", 0));
+      bool queued = flag("optimal") ? submit_solve(state, true, number("timeout", 60), deadline, req.disconnected, done)
+                                    : solve_cube(session, state, deadline, req.disconnected, done);
+      if (!queued) reply({503, "Too many solves waiting"});
+      return;
+    }
+    reply({404, "Not Found"});
+  });
+  auto handle_binary = [&](std::string& session, std::string_view request, http::Server::Reply reply,
+                           http::Disconnected disconnected) {
+    if (session.empty()) session = "default";
+    const uint8_t op = uint8_t(request[0]);
+    if (proto::is_move(op)) {
+      CubeState cube = sessions.apply(session, reinterpret_cast<const uint8_t*>(request.data()), request.size());
+      if (speculator) speculator->moved(session, cube.to_string());
+      return reply({});
+    }
+    if (op == proto::SESSION) {
+      session = std::string(request.substr(2));
+      return reply({});
+    }
+    if (op == proto::STATE) return reply({200, proto::encode_state(sessions.cube(session))});
+    if (op == proto::FACELETS) return reply({200, sessions.state(session)});
+    Done done = [reply](const std::string& solution, twophase::SolveStats*) {
+      reply({200, proto::encode_solution(solution)});
+    };
+    if (!solve_cube(session, sessions.state(session), 0, disconnected, done))
+      done("Error: Too many solves waiting.", nullptr);
+  };
+  if (!unix_path.empty()) {
+    try {
+      srv.listen_unix(unix_path, binary_request_size, handle_binary);
+    } catch (const std::runtime_error& e) {
+      std::fprintf(stderr, "cube-server: %s, serving HTTP only\n", e.what());
+    }
+  }
+  srv.every_second([&sessions, &speculator] {
+    sessions.evict_idle();
+    if (speculator) speculator->evict_idle();
+  });
+  server = &srv;
+  std::signal(SIGINT, on_signal);
+  std::signal(SIGTERM, on_signal);
+  std::printf("Starting Rubik's Cube HTTP server on port %d, up to %zu sessions...\n", port, max_sessions);
+  std::fflush(stdout);
+  srv.run();
+  // run() has closed all connections, so no reply can be sent any more and their running solves and batches have been
+  // cancelled. The solves still queued are dropped.
+  pool.reset();
+  if (speculator) {
+    Speculator::Counters c = speculator->counters();
+    std::printf("speculative solves: %llu started, %llu cancelled by a move, /solve %llu hits, %llu misses\n",
+                (unsigned long long)c.started, (unsigned long long)c.cancelled, (unsigned long long)c.hits,
+                (unsigned long long)c.misses);
+    speculator.reset();
+  }
+  if (cache) {
+    twophase::SolutionCache::Counters c = cache->counters();
+    std::printf("solution cache: %llu hits, %llu misses, %llu evictions, %zu solutions\n", (unsigned long long)c.hits,
+                (unsigned long long)c.misses, (unsigned long long)c.evictions, c.size);
+  }
+  return 0;
+}
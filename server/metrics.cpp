@@ -0,0 +1,147 @@
+#include "metrics.hpp"
+
+#include <cstdio>
+
+namespace {
+
+std::string number(double value) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%.9g", value);
+  return buf;
+}
+
+void header(std::string& out, const std::string& name, const char* type, const std::string& help) {
+  out += "# HELP " + name + " " + help + "\n# TYPE " + name + " " + type + "\n";
+}
+
+// A JSON array of the counters up to the last one which is not zero.
+std::string depth_array(const std::array<std::atomic<uint64_t>, twophase::SolveStats::MAX_DEPTH>& counts) {
+  int n = int(counts.size());
+  while (n > 0 && counts[n - 1] == 0) n--;
+  std::string s = "[";
+  for (int d = 0; d < n; d++) s += (d ? ", " : "") + std::to_string(counts[d].load());
+  return s + "]";
+}
+
+}  // namespace
+
+void Metrics::Histogram::add(double seconds) {
+  size_t i = 0;
+  while (i < BOUNDS.size() && seconds > BOUNDS[i]) i++;
+  counts[i]++;
+  sum += seconds;
+}
+
+void Metrics::Histogram::render(std::string& out, const std::string& name, const std::string& labels) const {
+  const std::string sep = labels.empty() ? "" : ",";
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i < BOUNDS.size(); i++) {
+    cumulative += counts[i];
+    out += name + "_bucket{" + labels + sep + "le=\"" + number(BOUNDS[i]) + "\"} " + std::to_string(cumulative) + "\n";
+  }
+  cumulative += counts.back();
+  out += name + "_bucket{" + labels + sep + "le=\"+Inf\"} " + std::to_string(cumulative) + "\n";
+  const std::string braces = labels.empty() ? "" : "{" + labels + "}";
+  out += name + "_sum" + braces + " " + number(sum) + "\n";
+  out += name + "_count" + braces + " " + std::to_string(cumulative) + "\n";
+}
+
+void Metrics::request(const std::string& endpoint, int status, double seconds) {
+  std::lock_guard guard(lock);
+  requests[{endpoint, status}]++;
+  request_seconds[endpoint].add(seconds);
+}
+
+void Metrics::solve(twophase::SolveStats& stats, bool optimal, bool solved, double seconds) {
+  std::lock_guard guard(lock);
+  solves[optimal][solved]++;
+  solve_seconds.add(seconds);
+  for (int d = 0; d < twophase::SolveStats::MAX_DEPTH; d++) {
+    phase1_nodes_by_depth[d] += stats.phase1_nodes_by_depth[d];
+    phase2_nodes_by_depth[d] += stats.phase2_nodes_by_depth[d];
+  }
+  optimal_nodes += stats.optimal_nodes;
+  prune_probes += stats.prune_probes;
+  phase2_entries += stats.phase2_entries;
+  busy_ns += stats.busy_ns;
+  thread_ns += stats.thread_ns;
+  wall_ns += stats.wall_ns;
+  lock_wait_ns += stats.lock_wait_ns;
+  std::lock_guard stats_guard(stats.lock);
+  improvements += stats.improvements.size();
+  if (!stats.improvements.empty()) first_solution_seconds.add(stats.improvements.front().first);
+}
+
+std::string Metrics::render() {
+  std::lock_guard guard(lock);
+  std::string out;
+  header(out, "cube_server_requests_total", "counter", "Requests by endpoint and status.");
+  for (const auto& [key, n] : requests)
+    out += "cube_server_requests_total{endpoint=\"" + key.first + "\",status=\"" + std::to_string(key.second) +
+           "\"} " + std::to_string(n) + "\n";
+  header(out, "cube_server_request_seconds", "histogram", "Time from the request to the end of its response.");
+  for (const auto& [endpoint, h] : request_seconds)
+    h.render(out, "cube_server_request_seconds", "endpoint=\"" + endpoint + "\"");
+
+  header(out, "twophase_solves_total", "counter", "Finished solves by solver and whether they found a solution.");
+  for (int optimal = 0; optimal < 2; optimal++)
+    for (int solved = 0; solved < 2; solved++)
+      out += std::string("twophase_solves_total{solver=\"") + (optimal ? "optimal" : "twophase") + "\",result=\"" +
+             (solved ? "solution" : "error") + "\"} " + std::to_string(solves[optimal][solved]) + "\n";
+  header(out, "twophase_solve_seconds", "histogram", "Duration of the solves.");
+  solve_seconds.render(out, "twophase_solve_seconds", "");
+  header(out, "twophase_first_solution_seconds", "histogram", "Time from the start of a solve to its first solution.");
+  first_solution_seconds.render(out, "twophase_first_solution_seconds", "");
+  header(out, "twophase_improvements_total", "counter", "Solutions found, each shorter than the ones before.");
+  out += "twophase_improvements_total " + std::to_string(improvements) + "\n";
+
+  header(out, "twophase_nodes_total", "counter", "Search nodes by phase and number of moves of the phase so far.");
+  for (int d = 0; d < twophase::SolveStats::MAX_DEPTH; d++)
+    if (phase1_nodes_by_depth[d])
+      out += "twophase_nodes_total{phase=\"1\",depth=\"" + std::to_string(d) + "\"} " +
+             std::to_string(phase1_nodes_by_depth[d]) + "\n";
+  for (int d = 0; d < twophase::SolveStats::MAX_DEPTH; d++)
+    if (phase2_nodes_by_depth[d])
+      out += "twophase_nodes_total{phase=\"2\",depth=\"" + std::to_string(d) + "\"} " +
+             std::to_string(phase2_nodes_by_depth[d]) + "\n";
+  out += "twophase_nodes_total{phase=\"optimal\"} " + std::to_string(optimal_nodes) + "\n";
+  out += metric("twophase_prune_probes_total", "counter", "Pruning table lookups.", double(prune_probes));
+  out += metric("twophase_phase2_entries_total", "counter", "Phase 1 solutions searched on in phase 2.",
+                double(phase2_entries));
+  out += metric("twophase_search_busy_seconds_total", "counter", "Run time of the search tasks over all threads.",
+                double(busy_ns) * 1e-9);
+  out += metric("twophase_search_thread_seconds_total", "counter", "Duration of the solves times the search threads.",
+                double(thread_ns) * 1e-9);
+  out += metric("twophase_search_wall_seconds_total", "counter", "Duration of the solves.", double(wall_ns) * 1e-9);
+  out += metric("twophase_lock_wait_seconds_total", "counter", "Waiting for the lock of the solutions found.",
+                double(lock_wait_ns) * 1e-9);
+  return out;
+}
+
+std::string metric(const std::string& name, const char* type, const std::string& help, double value) {
+  std::string out;
+  header(out, name, type, help);
+  return out + name + " " + number(value) + "\n";
+}
+
+std::string stats_json(twophase::SolveStats& stats) {
+  std::string s = "{\"phase1_nodes\": " + std::to_string(stats.phase1_nodes.load()) +
+                  ", \"phase2_nodes\": " + std::to_string(stats.phase2_nodes.load()) +
+                  ", \"optimal_nodes\": " + std::to_string(stats.optimal_nodes.load()) +
+                  ", \"phase1_nodes_by_depth\": " + depth_array(stats.phase1_nodes_by_depth) +
+                  ", \"phase2_nodes_by_depth\": " + depth_array(stats.phase2_nodes_by_depth) +
+                  ", \"prune_probes\": " + std::to_string(stats.prune_probes.load()) +
+                  ", \"phase2_entries\": " + std::to_string(stats.phase2_entries.load()) + ", \"improvements\": [";
+  {
+    std::lock_guard guard(stats.lock);
+    for (size_t i = 0; i < stats.improvements.size(); i++)
+      s += (i ? ", " : "") + std::string("{\"time\": ") + number(stats.improvements[i].first) +
+           ", \"length\": " + std::to_string(stats.improvements[i].second) + "}";
+  }
+  double thread = double(stats.thread_ns.load());
+  s += "], \"wall_seconds\": " + number(double(stats.wall_ns) * 1e-9) +
+       ", \"busy_seconds\": " + number(double(stats.busy_ns) * 1e-9) +
+       ", \"lock_wait_seconds\": " + number(double(stats.lock_wait_ns) * 1e-9) +
+       ", \"utilization\": " + number(thread > 0 ? double(stats.busy_ns) / thread : 0) + "}";
+  return s;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "twophase/solver.hpp"
+
+// Counters of the server and of its solves, served by GET /metrics in the Prometheus text format. Every solve of the
+// server collects a twophase::SolveStats, which is added here when it ends. The thread utilization of the search is
+// rate(twophase_search_busy_seconds_total) / rate(twophase_search_thread_seconds_total).
+class Metrics {
+public:
+  // A request to endpoint, one of a few fixed names, answered with status after seconds.
+  void request(const std::string& endpoint, int status, double seconds);
+  // A solve has ended after seconds. optimal: solve_optimal(), solved: the result is a solution.
+  void solve(twophase::SolveStats& stats, bool optimal, bool solved, double seconds);
+  // All counters in the Prometheus text format.
+  std::string render();
+
+private:
+  // Cumulative histogram of seconds.
+  struct Histogram {
+    static constexpr std::array<double, 10> BOUNDS = {0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 1, 5};
+    std::array<uint64_t, BOUNDS.size() + 1> counts{};  // the last one counts the values above all bounds
+    double sum = 0;
+    void add(double seconds);
+    void render(std::string& out, const std::string& name, const std::string& labels) const;
+  };
+
+  std::mutex lock;  // guards the members below
+  std::map<std::pair<std::string, int>, uint64_t> requests;  // by endpoint and status
+  std::map<std::string, Histogram> request_seconds;  // by endpoint
+  uint64_t solves[2][2] = {};  // by optimal and solved
+  Histogram solve_seconds, first_solution_seconds;
+  std::array<uint64_t, twophase::SolveStats::MAX_DEPTH> phase1_nodes_by_depth{}, phase2_nodes_by_depth{};
+  uint64_t optimal_nodes = 0, prune_probes = 0, phase2_entries = 0, improvements = 0;
+  uint64_t busy_ns = 0, thread_ns = 0, wall_ns = 0, lock_wait_ns = 0;
+};
+
+// One metric without labels in the Prometheus text format, type is "counter" or "gauge".
+std::string metric(const std::string& name, const char* type, const std::string& help, double value);
+
+// The statistics of one solve as a JSON object, returned with stats=1 on /solve.
+std::string stats_json(twophase::SolveStats& stats);
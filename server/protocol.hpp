@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cube_state.hpp"
+
+// Binary protocol of cube-server on a Unix domain socket, for clients on the same host. It carries what /move, /state
+// and /solve do without URLs, headers and facelet strings. Requests may be pipelined, the replies come in the order
+// of the requests, moves are not answered.
+//
+//   0x00-0x11         a move, twophase::Move: U1 U2 U3 R1 ... B3. Consecutive moves are applied together.
+//   STATE             reply: the cube in STATE_SIZE bytes, the corners and edges of CubeState
+//   FACELETS          reply: the 54 byte cube definition string
+//   SOLVE             reply: the number of moves n and n moves, or SOLVE_ERROR, the length and the message
+//   SESSION len id    the following requests are for session id, "default" until then
+
+namespace proto {
+
+constexpr uint8_t STATE = 0x80;
+constexpr uint8_t FACELETS = 0x81;
+constexpr uint8_t SOLVE = 0x82;
+constexpr uint8_t SESSION = 0x83;
+constexpr uint8_t SOLVE_ERROR = 0xff;
+
+constexpr size_t STATE_SIZE = 20;
+
+// The client tries this path before it falls back to HTTP.
+inline constexpr const char* DEFAULT_PATH = "/tmp/cube-server.sock";
+
+inline bool is_move(uint8_t b) { return b < twophase::N_MOVE; }
+
+// Length of the first request in, 0 if it is incomplete, std::string::npos if it is invalid.
+inline size_t request_size(std::string_view in) {
+  if (in.empty()) return 0;
+  uint8_t op = uint8_t(in[0]);
+  if (is_move(op)) {
+    size_t n = 1;
+    while (n < in.size() && is_move(uint8_t(in[n]))) n++;
+    return n;
+  }
+  if (op == STATE || op == FACELETS || op == SOLVE) return 1;
+  if (op == SESSION) return in.size() < 2 ? 0 : in.size() < 2 + size_t(uint8_t(in[1])) ? 0 : 2 + uint8_t(in[1]);
+  return std::string::npos;
+}
+
+inline std::string session_request(const std::string& session) {
+  return std::string(1, char(SESSION)) + char(session.size()) + session;
+}
+
+inline std::string encode_state(const CubeState& cube) {
+  std::string s(STATE_SIZE, '\0');
+  for (int i = 0; i < 8; i++) s[i] = char(cube.corners[i]);
+  for (int i = 0; i < 12; i++) s[8 + i] = char(cube.edges[i]);
+  return s;
+}
+
+inline CubeState decode_state(std::string_view s) {
+  CubeState cube;
+  for (int i = 0; i < 8; i++) cube.corners[i] = uint8_t(s[i]);
+  for (int i = 0; i < 12; i++) cube.edges[i] = uint8_t(s[8 + i]);
+  return cube;
+}
+
+// The reply to SOLVE of a solve() result.
+inline std::string encode_solution(const std::string& solution) {
+  std::vector<int> moves;
+  if (solution.starts_with("Error") || !parse_moves(solution, moves) || moves.size() >= SOLVE_ERROR) {
+    std::string msg = solution.substr(0, 255);
+    return std::string(1, char(SOLVE_ERROR)) + char(msg.size()) + msg;
+  }
+  std::string s(1, char(moves.size()));
+  for (int m : moves) s += char(m);
+  return s;
+}
+
+// Length of the reply to SOLVE at the start of in, 0 if it is incomplete.
+inline size_t solution_size(std::string_view in) {
+  if (in.empty()) return 0;
+  if (uint8_t(in[0]) != SOLVE_ERROR) return in.size() < 1 + size_t(uint8_t(in[0])) ? 0 : 1 + uint8_t(in[0]);
+  return in.size() < 2 || in.size() < 2 + size_t(uint8_t(in[1])) ? 0 : 2 + uint8_t(in[1]);
+}
+
+}  // namespace proto
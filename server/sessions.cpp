@@ -0,0 +1,74 @@
+#include "sessions.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+
+SessionStore::SessionStore(size_t max_sessions, Clock::duration idle_timeout)
+    : max_per_shard(std::max<size_t>(1, (max_sessions + SHARDS - 1) / SHARDS)), idle_timeout(idle_timeout) {}
+
+SessionStore::Shard& SessionStore::shard_of(const std::string& session) {
+  return shards[std::hash<std::string>{}(session) % SHARDS];
+}
+
+void SessionStore::drop_idle(Shard& shard, Clock::time_point now) {
+  while (!shard.lru.empty() && now - shard.lru.back().last_used > idle_timeout) {
+    shard.index.erase(shard.lru.back().id);
+    shard.lru.pop_back();
+  }
+}
+
+CubeState SessionStore::apply(const std::string& session, const uint8_t* moves, size_t n) {
+  Shard& shard = shard_of(session);
+  std::lock_guard guard(shard.lock);
+  const auto now = Clock::now();  // taken under the lock, so the list stays sorted by last_used
+  drop_idle(shard, now);
+  auto it = shard.index.find(session);
+  if (it != shard.index.end()) {
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+  } else {
+    if (shard.lru.size() >= max_per_shard) {
+      shard.index.erase(shard.lru.back().id);
+      shard.lru.pop_back();
+    }
+    shard.lru.push_front({session, CubeState(), now});
+    shard.index.emplace(session, shard.lru.begin());
+  }
+  Session& s = shard.lru.front();
+  s.last_used = now;
+  for (size_t i = 0; i < n; i++) s.cube.apply(moves[i]);
+  return s.cube;
+}
+
+CubeState SessionStore::cube(const std::string& session) {
+  Shard& shard = shard_of(session);
+  std::lock_guard guard(shard.lock);  // a read counts as use as well
+  auto it = shard.index.find(session);
+  if (it == shard.index.end()) return CubeState();
+  shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+  it->second->last_used = Clock::now();
+  return it->second->cube;
+}
+
+void SessionStore::evict_idle() {
+  const auto now = Clock::now();
+  for (Shard& shard : shards) {
+    std::lock_guard guard(shard.lock);
+    drop_idle(shard, now);
+  }
+}
+
+size_t SessionStore::size() {
+  size_t n = 0;
+  for (Shard& shard : shards) {
+    std::lock_guard guard(shard.lock);
+    n += shard.lru.size();
+  }
+  return n;
+}
+
+bool SessionStore::valid_id(const std::string& session) {
+  if (session.empty() || session.size() > 64) return false;
+  return std::all_of(session.begin(), session.end(),
+                     [](char ch) { return std::isalnum((unsigned char)ch) || ch == '-' || ch == '_'; });
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "cube_state.hpp"
+
+// The cubes of all clients of the server, keyed by the session id the client sends with its requests. The sessions
+// are spread over shards with a lock each, so requests of different sessions rarely wait for each other. Every shard
+// keeps its sessions in least recently used order: sessions idle for longer than the idle timeout are dropped, and if
+// the store is full the least recently used session of the shard makes room. A dropped session starts solved again.
+class SessionStore {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  // Rough memory of one session: the list node with the id and the cube, the hash map node with the id again and its
+  // bucket, both with the overhead of malloc.
+  static constexpr size_t BYTES_PER_SESSION = 192;
+
+  SessionStore(size_t max_sessions, Clock::duration idle_timeout);
+
+  // Apply the moves (twophase::Move) to the cube of session, a new session starts solved. Returns the new cube.
+  CubeState apply(const std::string& session, const uint8_t* moves, size_t n);
+  // Cube of session, solved for an unknown session, which is not created.
+  CubeState cube(const std::string& session);
+  // Cube definition string of the cube of session.
+  std::string state(const std::string& session) { return cube(session).to_string(); }
+  // Drop the sessions idle for longer than the idle timeout.
+  void evict_idle();
+  size_t size();
+
+  // Session ids are 1 to 64 letters, digits, '-' or '_'.
+  static bool valid_id(const std::string& session);
+
+private:
+  static constexpr size_t SHARDS = 64;
+
+  struct Session {
+    std::string id;
+    CubeState cube;
+    Clock::time_point last_used;
+  };
+
+  struct alignas(64) Shard {
+    std::mutex lock;
+    std::list<Session> lru;  // most recently used first
+    std::unordered_map<std::string, std::list<Session>::iterator> index;
+  };
+
+  Shard& shard_of(const std::string& session);
+  void drop_idle(Shard& shard, Clock::time_point now);
+
+  const size_t max_per_shard;
+  const Clock::duration idle_timeout;
+  std::array<Shard, SHARDS> shards;
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads which run the solves of the server, so the event loop only ever waits for short requests. Every solve
+// itself searches on the work-stealing pool of twophase, these threads only limit how many solves run at once.
+class SolverPool {
+public:
+  using Job = std::function<void()>;
+
+  SolverPool(int threads, size_t max_queued) : max_queued(max_queued) {
+    for (int i = 0; i < threads; i++) workers.emplace_back(&SolverPool::run, this);
+  }
+  ~SolverPool() {
+    {
+      std::lock_guard guard(lock);
+      stopping = true;
+      jobs.clear();  // the queued jobs are dropped, the running ones are waited for
+    }
+    wakeup.notify_all();
+    for (std::thread& t : workers) t.join();
+  }
+
+  // Queue a job. Returns false if max_queued jobs are already waiting, the caller should answer "busy", or if the pool
+  // is being destroyed.
+  bool submit(Job job) {
+    {
+      std::lock_guard guard(lock);
+      if (stopping || jobs.size() >= max_queued) return false;
+      jobs.push_back(std::move(job));
+    }
+    wakeup.notify_one();
+    return true;
+  }
+
+  size_t size() const { return workers.size(); }
+
+private:
+  void run() {
+    std::unique_lock guard(lock);
+    while (true) {
+      wakeup.wait(guard, [this] { return stopping || !jobs.empty(); });
+      if (jobs.empty()) return;
+      Job job = std::move(jobs.front());
+      jobs.pop_front();
+      guard.unlock();
+      job();
+      guard.lock();
+    }
+  }
+
+  const size_t max_queued;
+  std::mutex lock;
+  std::condition_variable wakeup;
+  std::deque<Job> jobs;
+  bool stopping = false;
+  std::vector<std::thread> workers;
+};
@@ -0,0 +1,128 @@
+#include "speculation.hpp"
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <cstdlib>
+
+namespace {
+
+// Scheduling priority of the speculative searches, the requested solves run at 0.
+constexpr int NICE = 10;
+
+int length_of(const std::string& solution) {
+  size_t paren = solution.rfind('(');
+  return paren == std::string::npos ? 0 : std::atoi(solution.c_str() + paren + 1);
+}
+
+}  // namespace
+
+Speculator::Speculator(int solvers, int max_length, double timeout, size_t max_sessions,
+                       Clock::duration idle_timeout, const twophase::SolveHooks& hooks)
+    : max_length(max_length),
+      timeout(timeout),
+      max_sessions(max_sessions),
+      idle_timeout(idle_timeout),
+      hooks(hooks),
+      pool(int(std::thread::hardware_concurrency()), NICE) {
+  this->hooks.pool = &pool;
+  for (int i = 0; i < solvers; i++) workers.emplace_back(&Speculator::run, this);
+}
+
+Speculator::~Speculator() {
+  {
+    std::lock_guard guard(lock);
+    stopping = true;
+    for (auto& [id, e] : entries)
+      if (e.cancel) *e.cancel = true;
+  }
+  wakeup.notify_all();
+  for (std::thread& t : workers) t.join();
+}
+
+void Speculator::moved(const std::string& session, const std::string& state) {
+  {
+    std::lock_guard guard(lock);
+    auto it = entries.find(session);
+    if (it == entries.end()) {
+      if (entries.size() >= max_sessions) return;
+      it = entries.emplace(session, Entry()).first;
+    }
+    Entry& e = it->second;
+    if (e.cancel) {
+      *e.cancel = true;
+      e.cancel.reset();
+      stats.cancelled++;
+    }
+    e.state = state;
+    e.best.clear();
+    e.last_used = Clock::now();
+    if (e.queued) return;  // the queued solve picks up the new state
+    e.queued = true;
+    queue.push_back(session);
+  }
+  wakeup.notify_one();
+}
+
+std::string Speculator::result(const std::string& session, const std::string& state, int max_length) {
+  std::lock_guard guard(lock);
+  auto it = entries.find(session);
+  if (it == entries.end() || it->second.state != state || it->second.best.empty() ||
+      length_of(it->second.best) > max_length) {
+    stats.misses++;
+    return "";
+  }
+  stats.hits++;
+  it->second.last_used = Clock::now();
+  return it->second.best;
+}
+
+void Speculator::evict_idle() {
+  std::lock_guard guard(lock);
+  const auto now = Clock::now();
+  std::erase_if(entries, [&](const auto& item) {
+    const Entry& e = item.second;
+    return !e.queued && !e.cancel && now - e.last_used > idle_timeout;
+  });
+}
+
+Speculator::Counters Speculator::counters() {
+  std::lock_guard guard(lock);
+  return stats;
+}
+
+void Speculator::run() {
+  ::setpriority(PRIO_PROCESS, ::gettid(), NICE);  // this thread helps with the search tasks
+  std::unique_lock guard(lock);
+  while (true) {
+    wakeup.wait(guard, [this] { return stopping || !queue.empty(); });
+    if (stopping) return;
+    std::string session = std::move(queue.front());
+    queue.pop_front();
+    auto it = entries.find(session);
+    if (it == entries.end()) continue;
+    Entry& e = it->second;
+    e.queued = false;
+    const std::string state = e.state;
+    auto cancel = std::make_shared<std::atomic<bool>>(false);
+    e.cancel = cancel;
+    stats.started++;
+    guard.unlock();
+
+    // The entry may be moved on or dropped meanwhile, a solution is only kept while the state is still the same.
+    auto keep = [this, &session, &state, &cancel](const std::string& solution) {
+      std::lock_guard guard(lock);
+      auto it = entries.find(session);
+      if (it != entries.end() && it->second.state == state && it->second.cancel == cancel) it->second.best = solution;
+    };
+    twophase::SolveHooks h = hooks;
+    h.cancel = cancel.get();
+    h.improved = keep;  // called with every shorter solution, the anytime result
+    std::string solution = twophase::solve(state, max_length, timeout, h);
+    if (!solution.starts_with("Error")) keep(solution);
+
+    guard.lock();
+    it = entries.find(session);
+    if (it != entries.end() && it->second.cancel == cancel) it->second.cancel.reset();
+  }
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "twophase/solver.hpp"
+#include "twophase/thread_pool.hpp"
+
+// Solves started in the background while a client is still turning its cube. Every /move of a session cancels the
+// running speculative solve of the session and queues one for the new state. The speculative solves search on their
+// own pool with a lower scheduling priority, so they only use the cores the requested solves leave idle, and keep the
+// best solution found so far. A /solve of a state which has been solved in the background is answered at once.
+class Speculator {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  // solvers speculative solves run at the same time, each searches for a maneuver of at most max_length moves for up
+  // to timeout seconds. At most max_sessions sessions are tracked, results unused for idle_timeout are dropped.
+  Speculator(int solvers, int max_length, double timeout, size_t max_sessions, Clock::duration idle_timeout,
+             const twophase::SolveHooks& hooks);
+  ~Speculator();
+  Speculator(const Speculator&) = delete;
+  Speculator& operator=(const Speculator&) = delete;
+
+  // The cube of session is now in state.
+  void moved(const std::string& session, const std::string& state);
+  // The best speculative solution of state if it has at most max_length moves, else an empty string.
+  std::string result(const std::string& session, const std::string& state, int max_length);
+  // Drop the results of sessions idle for longer than the idle timeout.
+  void evict_idle();
+
+  struct Counters {
+    uint64_t started, cancelled, hits, misses;
+  };
+  Counters counters();
+
+private:
+  struct Entry {
+    std::string state;  // the latest state of the cube
+    std::string best;  // best solution of state so far
+    std::shared_ptr<std::atomic<bool>> cancel;  // of the running solve, if any
+    bool queued = false;
+    Clock::time_point last_used;
+  };
+
+  void run();  // one speculation thread
+
+  const int max_length;
+  const double timeout;
+  const size_t max_sessions;
+  const Clock::duration idle_timeout;
+  twophase::SolveHooks hooks;
+  twophase::ThreadPool pool;
+  std::mutex lock;  // guards the members below
+  std::condition_variable wakeup;
+  std::unordered_map<std::string, Entry> entries;
+  std::deque<std::string> queue;  // sessions waiting for a speculative solve, each at most once
+  bool stopping = false;
+  Counters stats{};
+  std::vector<std::thread> workers;
+};
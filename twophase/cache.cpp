@@ -0,0 +1,188 @@
+#include "cache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "symmetries.hpp"
+
+namespace twophase {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// R1 -> R3, R2 -> R2, R3 -> R1 etc.
+inline int inverse_move(int m) { return (m / 3) * 3 + (2 - m % 3); }
+
+}  // namespace
+
+SolutionCache::SolutionCache(size_t capacity, std::string path) : capacity(std::max<size_t>(1, capacity)), path(path) {
+  if (!path.empty()) load();
+}
+
+SolutionCache::~SolutionCache() {
+  if (!path.empty()) save();
+}
+
+SolutionCache::Key SolutionCache::pack(const CubieCube& cc) {
+  Key k{0, 0};
+  for (int i = 0; i < 8; i++) k.corners |= uint64_t(cc.cp[i] + 8 * cc.co[i]) << (8 * i);
+  for (int i = 0; i < 12; i++) k.edges |= uint64_t(cc.ep[i] + 16 * cc.eo[i]) << (5 * i);
+  return k;
+}
+
+bool SolutionCache::solves(const Key& key, const std::vector<uint8_t>& man) {
+  CubieCube cc;
+  for (int i = 0; i < 8; i++) {
+    cc.cp[i] = uint8_t(key.corners >> (8 * i) & 7);
+    cc.co[i] = uint8_t(key.corners >> (8 * i + 3) & 31);
+  }
+  for (int i = 0; i < 12; i++) {
+    cc.ep[i] = uint8_t(key.edges >> (5 * i) & 15);
+    cc.eo[i] = uint8_t(key.edges >> (5 * i + 4) & 1);
+  }
+  if (pack(cc) != key || !cc.verify().empty()) return false;
+  for (int m : man) cc.multiply(moveCube[m]);
+  return cc == CubieCube();
+}
+
+SolutionCache::Key SolutionCache::canonical(const CubieCube& cc, Frame& frame) {
+  CubieCube inv;
+  cc.inv_cubie_cube(inv);
+  Key best{~0ULL, ~0ULL};
+  for (int s = 0; s < N_SYM; s++) {
+    for (int i = 0; i < 2; i++) {
+      CubieCube c = symCube[s];
+      c.multiply(i ? inv : cc);
+      c.multiply(symCube[inv_idx[s]]);  // s * cc * s^-1, of the inverse for i = 1
+      Key k = pack(c);
+      if (k < best) {
+        best = k;
+        frame = {s, i == 1};
+      }
+    }
+  }
+  return best;
+}
+
+std::vector<int> SolutionCache::to_cube(const std::vector<uint8_t>& man, Frame frame) {
+  std::vector<int> ret;
+  for (int m : man) ret.push_back(sy::conj_move[N_MOVE * inv_idx[frame.sym] + m]);
+  if (frame.inv) {  // we have a solution of the inverse cube
+    std::reverse(ret.begin(), ret.end());
+    for (int& m : ret) m = inverse_move(m);
+  }
+  return ret;
+}
+
+std::vector<uint8_t> SolutionCache::to_rep(const std::vector<int>& man, Frame frame) {
+  std::vector<int> tmp = man;
+  if (frame.inv) {
+    std::reverse(tmp.begin(), tmp.end());
+    for (int& m : tmp) m = inverse_move(m);
+  }
+  std::vector<uint8_t> ret;
+  for (int m : tmp) ret.push_back(sy::conj_move[N_MOVE * frame.sym + m]);
+  return ret;
+}
+
+bool SolutionCache::lookup(const CubieCube& cc, int max_length, std::vector<int>& man) {
+  Frame frame;
+  Key key = canonical(cc, frame);  // outside of the lock, this is the expensive part
+  std::lock_guard guard(lock);
+  auto it = index.find(key);
+  if (it == index.end() || int(it->second->man.size()) > max_length) {
+    stats.misses++;
+    return false;
+  }
+  lru.splice(lru.begin(), lru, it->second);
+  stats.hits++;
+  man = to_cube(it->second->man, frame);
+  return true;
+}
+
+void SolutionCache::insert(const CubieCube& cc, const std::vector<int>& man) {
+  Frame frame;
+  Key key = canonical(cc, frame);
+  std::vector<uint8_t> rep = to_rep(man, frame);
+  std::lock_guard guard(lock);
+  put(key, std::move(rep));
+}
+
+void SolutionCache::put(const Key& key, std::vector<uint8_t> man) {
+  auto it = index.find(key);
+  if (it != index.end()) {
+    lru.splice(lru.begin(), lru, it->second);
+    if (man.size() < it->second->man.size()) it->second->man = std::move(man);
+    return;
+  }
+  if (lru.size() >= capacity) {
+    index.erase(lru.back().key);
+    lru.pop_back();
+    stats.evictions++;
+  }
+  lru.push_front({key, std::move(man)});
+  index.emplace(key, lru.begin());
+}
+
+SolutionCache::Counters SolutionCache::counters() {
+  std::lock_guard guard(lock);
+  Counters c = stats;
+  c.size = lru.size();
+  return c;
+}
+
+// One solution per line, least recently used first: the key in hex and the moves, "<corners> <edges> U1 R2 ...".
+bool SolutionCache::save() {
+  if (path.empty()) return false;
+  std::ostringstream text;
+  {
+    std::lock_guard guard(lock);
+    char key[40];
+    for (auto it = lru.rbegin(); it != lru.rend(); ++it) {
+      std::snprintf(key, sizeof(key), "%016llx %016llx", (unsigned long long)it->key.corners,
+                    (unsigned long long)it->key.edges);
+      text << key;
+      for (int m : it->man) text << ' ' << move_name[m];
+      text << '\n';
+    }
+  }
+  const fs::path tmp = path + ".tmp";
+  {
+    std::ofstream out(tmp);
+    out << text.str();
+    if (!out) {
+      std::cerr << "could not store the solution cache " << path << std::endl;
+      return false;
+    }
+  }
+  std::error_code ec;
+  fs::rename(tmp, path, ec);  // a crash while writing keeps the old file
+  return !ec;
+}
+
+void SolutionCache::load() {
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream words(line);
+    Key key;
+    std::vector<uint8_t> man;
+    if (!(words >> std::hex >> key.corners >> key.edges)) continue;
+    std::string name;
+    bool valid = true;
+    while (valid && words >> name) {
+      auto m = std::find_if(std::begin(move_name), std::end(move_name), [&](const char* n) { return name == n; });
+      valid = m != std::end(move_name);
+      man.push_back(uint8_t(m - std::begin(move_name)));
+    }
+    if (valid && solves(key, man)) put(key, std::move(man));  // later lines are more recent, they end up in front
+  }
+  stats = Counters();
+}
+
+}  // namespace twophase
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cubie.hpp"
+
+// ################### Cache of solutions, shared by symmetric and inverse positions ####################################
+// A position, its 48 conjugates by the cube symmetries and their inverses all need the same number of moves, a solution
+// of one of them is turned into a solution of any other by conjugating and inverting the maneuver. The cache therefore
+// stores one solution per class under the smallest of these up to 96 cubes and translates it back on a hit.
+
+namespace twophase {
+
+class SolutionCache {
+public:
+  struct Counters {
+    uint64_t hits = 0;
+    uint64_t misses = 0;  // includes the lookups whose cached solution was longer than max_length
+    uint64_t evictions = 0;
+    size_t size = 0;
+  };
+
+  // Keep at most capacity solutions, the least recently used are dropped. With a path the solutions are loaded from
+  // the file if it exists and stored there by save() and by the destructor.
+  explicit SolutionCache(size_t capacity, std::string path = "");
+  ~SolutionCache();
+  SolutionCache(const SolutionCache&) = delete;
+  SolutionCache& operator=(const SolutionCache&) = delete;
+
+  // Look up a solution of cc with at most max_length moves, stored in man as a list of moves. May be called from any
+  // thread.
+  bool lookup(const CubieCube& cc, int max_length, std::vector<int>& man);
+  // Store the solution man of cc, unless the cache knows a shorter one already.
+  void insert(const CubieCube& cc, const std::vector<int>& man);
+  // Store all solutions in the file, replacing it at once. Returns false if there is no path or it cannot be written.
+  bool save();
+  Counters counters();
+
+private:
+  // A cubie cube packed into two words, corners: cp + 8 * co per byte, edges: ep + 16 * eo per 5 bits.
+  struct Key {
+    uint64_t corners, edges;
+    bool operator==(const Key&) const = default;
+    auto operator<=>(const Key&) const = default;
+  };
+  struct KeyHash {
+    size_t operator()(const Key& k) const { return k.corners * 0x9e3779b97f4a7c15ULL ^ k.edges; }
+  };
+  // How the cube of a lookup is obtained from the representative: cc = s^-1 * rep * s, inverted if inv.
+  struct Frame {
+    int sym;
+    bool inv;
+  };
+  struct Entry {
+    Key key;
+    std::vector<uint8_t> man;  // solution of the representative
+  };
+
+  static Key pack(const CubieCube& cc);
+  static Key canonical(const CubieCube& cc, Frame& frame);
+  // Check a solution read from the file.
+  static bool solves(const Key& key, const std::vector<uint8_t>& man);
+  // Translate a maneuver between the frame of the representative and the frame of the cube.
+  static std::vector<int> to_cube(const std::vector<uint8_t>& man, Frame frame);
+  static std::vector<uint8_t> to_rep(const std::vector<int>& man, Frame frame);
+  void put(const Key& key, std::vector<uint8_t> man);  // lock must be held
+  void load();
+
+  const size_t capacity;
+  const std::string path;
+  std::mutex lock;  // guards everything below, held only for the map operations and never during a search
+  std::list<Entry> lru;  // most recently used first
+  std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+  Counters stats;
+};
+
+}  // namespace twophase
@@ -0,0 +1,143 @@
+#include "coord.hpp"
+
+#include <vector>
+
+#include "moves.hpp"
+#include "pruning.hpp"
+#include "symmetries.hpp"
+
+namespace twophase {
+
+CoordCube::CoordCube(const CubieCube& cc)
+    : twist(cc.get_twist())
+    , flip(cc.get_flip())
+    , slice_sorted(cc.get_slice_sorted())
+    , u_edges(cc.get_u_edges())
+    , d_edges(cc.get_d_edges())
+    , corners(cc.get_corners())
+    , ud_edges(slice_sorted < N_PERM_4 ? cc.get_ud_edges() : -1) {}
+
+void CoordCube::phase1_move(int m) {
+  twist = mv::twist_move[N_MOVE * twist + m];
+  flip = mv::flip_move[N_MOVE * flip + m];
+  slice_sorted = mv::slice_sorted_move[N_MOVE * slice_sorted + m];
+  // optional:
+  u_edges = mv::u_edges_move[N_MOVE * u_edges + m];  // u_edges and d_edges retrieve ud_edges easily
+  d_edges = mv::d_edges_move[N_MOVE * d_edges + m];  // if phase 1 is finished and phase 2 starts
+  corners = mv::corners_move[N_MOVE * corners + m];  // Is needed only in phase 2
+}
+
+void CoordCube::phase2_move(int m) {
+  slice_sorted = mv::slice_sorted_move[N_MOVE * slice_sorted + m];
+  corners = mv::corners_move[N_MOVE * corners + m];
+  ud_edges = mv::ud_edges_move[N_MOVE * ud_edges + m];
+}
+
+int CoordCube::get_depth_phase1() const {
+  int slice_ = slice_sorted / N_PERM_4;
+  int flip_ = flip;
+  int twist_ = twist;
+  int flipslice = N_FLIP * slice_ + flip_;
+  int classidx = sy::flipslice_classidx[flipslice];
+  int sym = sy::flipslice_sym[flipslice];
+  int depth_mod3 = int(pr::get_flipslice_twist_depth3(N_TWIST * classidx + sy::twist_conj[(twist_ << 4) + sym]));
+
+  int depth = 0;
+  while (flip_ != SOLVED || slice_ != SOLVED || twist_ != SOLVED) {
+    if (depth_mod3 == 0) depth_mod3 = 3;
+    for (int m = 0; m < N_MOVE; m++) {
+      int twist1 = mv::twist_move[N_MOVE * twist_ + m];
+      int flip1 = mv::flip_move[N_MOVE * flip_ + m];
+      int slice1 = mv::slice_sorted_move[N_MOVE * slice_ * N_PERM_4 + m] / N_PERM_4;
+      int flipslice1 = N_FLIP * slice1 + flip1;
+      int classidx1 = sy::flipslice_classidx[flipslice1];
+      int sym1 = sy::flipslice_sym[flipslice1];
+      if (int(pr::get_flipslice_twist_depth3(N_TWIST * classidx1 + sy::twist_conj[(twist1 << 4) + sym1])) ==
+          depth_mod3 - 1) {
+        depth++;
+        twist_ = twist1;
+        flip_ = flip1;
+        slice_ = slice1;
+        depth_mod3--;
+        break;
+      }
+    }
+  }
+  return depth;
+}
+
+int CoordCube::get_depth_phase2(int corners, int ud_edges) {
+  static constexpr Move phase2_moves[10] = {U1, U2, U3, R2, F2, D1, D2, D3, L2, B2};
+  int classidx = sy::corner_classidx[corners];
+  int sym = sy::corner_sym[corners];
+  int depth_mod3 = int(pr::get_corners_ud_edges_depth3(N_UD_EDGES * classidx + sy::ud_edges_conj[(ud_edges << 4) + sym]));
+  if (depth_mod3 == 3) return 11;  // unfilled entry, depth >= 11
+  int depth = 0;
+  while (corners != SOLVED || ud_edges != SOLVED) {
+    if (depth_mod3 == 0) depth_mod3 = 3;
+    for (Move m : phase2_moves) {  // only iterate phase 2 moves
+      int corners1 = mv::corners_move[N_MOVE * corners + m];
+      int ud_edges1 = mv::ud_edges_move[N_MOVE * ud_edges + m];
+      int classidx1 = sy::corner_classidx[corners1];
+      int sym1 = sy::corner_sym[corners1];
+      if (int(pr::get_corners_ud_edges_depth3(N_UD_EDGES * classidx1 + sy::ud_edges_conj[(ud_edges1 << 4) + sym1])) ==
+          depth_mod3 - 1) {
+        depth++;
+        corners = corners1;
+        ud_edges = ud_edges1;
+        depth_mod3--;
+        break;
+      }
+    }
+  }
+  return depth;
+}
+
+namespace coord {
+
+Table<uint16_t> u_edges_plus_d_edges_to_ud_edges;
+
+namespace {
+
+std::vector<uint16_t> create_phase2_edgemerge_table() {
+  std::vector<uint16_t> table(N_U_EDGES_PHASE2 * N_PERM_4, 0);
+  CubieCube c_u, c_d, c_ud;
+  auto in = [](uint8_t e, int first) { return first <= e && e <= first + 3; };
+  for (int i = 0; i < N_U_EDGES_PHASE2; i++) {
+    c_u.set_u_edges(i);
+    for (int j = 0; j < N_CHOOSE_8_4; j++) {
+      c_d.set_d_edges(j * N_PERM_4);
+      bool invalid = false;
+      for (int e = UR; e <= DB; e++) {
+        c_ud.ep[e] = 0xff;  // invalidate edges
+        if (in(c_u.ep[e], UR)) c_ud.ep[e] = c_u.ep[e];
+        if (in(c_d.ep[e], DR)) c_ud.ep[e] = c_d.ep[e];
+        if (c_ud.ep[e] == 0xff) {
+          invalid = true;  // edge collision
+          break;
+        }
+      }
+      if (invalid) continue;
+      for (int k = 0; k < N_PERM_4; k++) {
+        c_d.set_d_edges(j * N_PERM_4 + k);
+        for (int e = UR; e <= DB; e++) {
+          if (in(c_u.ep[e], UR)) c_ud.ep[e] = c_u.ep[e];
+          if (in(c_d.ep[e], DR)) c_ud.ep[e] = c_d.ep[e];
+        }
+        table[N_PERM_4 * i + k] = uint16_t(c_ud.get_ud_edges());
+      }
+    }
+  }
+  return table;
+}
+
+}  // namespace
+
+void init() {
+  u_edges_plus_d_edges_to_ud_edges =
+      load_or_create<uint16_t>("phase2_edgemerge", N_U_EDGES_PHASE2 * N_PERM_4, create_phase2_edgemerge_table);
+}
+
+}  // namespace coord
+
+}  // namespace twophase
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+
+#include "cubie.hpp"
+#include "tables.hpp"
+
+// ##### The cube on the coordinate level. It is described by a 3-tuple of natural numbers in phase 1 and phase 2. ######
+// Mirrors kociemba/coord.py.
+
+namespace twophase {
+
+inline constexpr int SOLVED = 0;  // 0 is index of solved state (except for u_edges coordinate)
+
+// Represent a cube on the coordinate level.
+// In phase 1 a state is uniquely determined by the three coordinates flip, twist and slice = slicesorted / 24.
+// In phase 2 a state is uniquely determined by the three coordinates corners, ud_edges and slice_sorted % 24.
+struct CoordCube {
+  int twist = SOLVED;  // twist of corners
+  int flip = SOLVED;  // flip of edges
+  int slice_sorted = SOLVED;  // Position of FR, FL, BL, BR edges. Valid in phase 1 (<11880) and phase 2 (<24)
+  int u_edges = 1656;  // Valid in phase 1 (<11880) and phase 2 (<1680). 1656 is the index of solved u_edges.
+  int d_edges = SOLVED;  // Valid in phase 1 (<11880) and phase 2 (<1680)
+  int corners = SOLVED;  // corner permutation. Valid in phase1 and phase2
+  int ud_edges = SOLVED;  // permutation of the ud-edges. Valid only in phase 2
+
+  CoordCube() = default;
+  explicit CoordCube(const CubieCube& cc);
+
+  // Update phase 1 coordinates when move is applied.
+  void phase1_move(int m);
+  // Update phase 2 coordinates when move is applied.
+  void phase2_move(int m);
+
+  // Compute the distance to the cube subgroup H where flip=slice=twist=0
+  int get_depth_phase1() const;
+  // Get distance to subgroup where only the UD-slice edges may be permuted in their slice. This is a lower bound for
+  // the number of moves to solve phase 2.
+  static int get_depth_phase2(int corners, int ud_edges);
+};
+
+namespace coord {
+
+// phase2_edgemerge retrieves the initial phase 2 ud_edges coordinate from the u_edges and d_edges coordinates.
+extern Table<uint16_t> u_edges_plus_d_edges_to_ud_edges;
+
+// Load the phase2_edgemerge table from FOLDER or create it.
+void init();
+
+}  // namespace coord
+
+}  // namespace twophase
@@ -0,0 +1,278 @@
+#include "cubie.hpp"
+
+#include "face.hpp"
+#include "misc.hpp"
+#include "symmetries.hpp"
+
+namespace twophase {
+
+std::string CubieCube::to_string() const {
+  auto pair = [](std::string& s, int p, int o) {
+    s += '(';
+    s += std::to_string(p);
+    s += ',';
+    s += std::to_string(o);
+    s += ')';
+  };
+  std::string s;
+  s.reserve(8 * 5 + 1 + 12 * 6);  // "(p,o)" per corner, up to "(pp,o)" per edge
+  for (int i = URF; i <= DRB; i++) pair(s, cp[i], co[i]);
+  s += '\n';
+  for (int i = UR; i <= BR; i++) pair(s, ep[i], eo[i]);
+  return s;
+}
+
+FaceCube CubieCube::to_facelet_cube() const {
+  FaceCube fc;
+  for (int i = URF; i <= DRB; i++) {
+    int j = cp[i];  // corner j is at corner position i
+    int ori = co[i];  // orientation of C j at position i
+    for (int k = 0; k < 3; k++) fc.f[cornerFacelet[i][(k + ori) % 3]] = cornerColor[j][k];
+  }
+  for (int i = UR; i <= BR; i++) {
+    int j = ep[i];  // similar for Es
+    int ori = eo[i];
+    for (int k = 0; k < 2; k++) fc.f[edgeFacelet[i][(k + ori) % 2]] = edgeColor[j][k];
+  }
+  return fc;
+}
+
+void CubieCube::inv_cubie_cube(CubieCube& d) const {
+  for (int e = UR; e <= BR; e++) d.ep[ep[e]] = uint8_t(e);
+  for (int e = UR; e <= BR; e++) d.eo[e] = eo[d.ep[e]];
+  for (int c = URF; c <= DRB; c++) d.cp[cp[c]] = uint8_t(c);
+  for (int c = URF; c <= DRB; c++) {
+    int ori = co[d.cp[c]];
+    d.co[c] = uint8_t(ori >= 3 ? ori : (3 - ori) % 3);
+  }
+}
+
+int CubieCube::corner_parity() const {
+  int s = 0;
+  for (int i = DRB; i > URF; i--)
+    for (int j = i - 1; j >= URF; j--)
+      if (cp[j] > cp[i]) s++;
+  return s % 2;
+}
+
+int CubieCube::edge_parity() const {
+  int s = 0;
+  for (int i = BR; i > UR; i--)
+    for (int j = i - 1; j >= UR; j--)
+      if (ep[j] > ep[i]) s++;
+  return s % 2;
+}
+
+std::vector<int> CubieCube::symmetries() const {
+  std::vector<int> s;
+  CubieCube d;
+  for (int j = 0; j < N_SYM; j++) {
+    CubieCube c = symCube[j];
+    c.multiply(*this);
+    c.multiply(symCube[inv_idx[j]]);
+    if (*this == c) s.push_back(j);
+    c.inv_cubie_cube(d);
+    if (*this == d) s.push_back(j + N_SYM);  // then we have antisymmetry
+  }
+  return s;
+}
+
+// ###################################### coordinates for phase 1 and 2 #################################################
+int CubieCube::get_slice() const {
+  int a = 0, x = 0;
+  // Compute the index a < (12 choose 4)
+  for (int j = BR; j >= UR; j--) {
+    if (FR <= ep[j] && ep[j] <= BR) {
+      a += c_nk(11 - j, x + 1);
+      x++;
+    }
+  }
+  return a;
+}
+
+namespace {
+
+// Place the four edges edge4 at the location given by a < (12 choose 4) and fill the remaining positions with other.
+void set_edge4(std::array<uint8_t, 12>& ep, const uint8_t* edge4, const uint8_t* other, int a) {
+  ep.fill(0xff);  // Invalidate all edge positions
+  int x = 4;  // set slice edges
+  for (int j = UR; j <= BR; j++) {
+    if (a - c_nk(11 - j, x) >= 0) {
+      ep[j] = edge4[4 - x];
+      a -= c_nk(11 - j, x);
+      x--;
+    }
+  }
+  x = 0;  // set the remaining edges
+  for (int j = UR; j <= BR; j++)
+    if (ep[j] == 0xff) ep[j] = other[x++];
+}
+
+// Generate the permutation of edge4 from index b < 4!.
+void permute_edge4(uint8_t* edge4, int b) {
+  for (int j = 1; j < 4; j++) {
+    int k = b % (j + 1);
+    b /= j + 1;
+    while (k-- > 0) rotate_right(edge4, 0, j);
+  }
+}
+
+// Index 24 * a + b of the location a and permutation b of the four edges first..first + 3 in ep.
+int get_edge4(const uint8_t* ep, int first) {
+  int a = 0, x = 0;
+  uint8_t edge4[4] = {};
+  // First compute the index a < (12 choose 4) and the permutation array perm.
+  for (int j = BR; j >= UR; j--) {
+    if (first <= ep[j] && ep[j] <= first + 3) {
+      a += c_nk(11 - j, x + 1);
+      edge4[3 - x] = ep[j];
+      x++;
+    }
+  }
+  // Then compute the index b < 4! for the permutation in edge4
+  int b = 0;
+  for (int j = 3; j > 0; j--) {
+    int k = 0;
+    while (edge4[j] != j + first) {
+      rotate_left(edge4, 0, j);
+      k++;
+    }
+    b = (j + 1) * b + k;
+  }
+  return 24 * a + b;
+}
+
+}  // namespace
+
+void CubieCube::set_slice(int idx) {
+  const uint8_t slice_edge[4] = {FR, FL, BL, BR};
+  const uint8_t other_edge[8] = {UR, UF, UL, UB, DR, DF, DL, DB};
+  set_edge4(ep, slice_edge, other_edge, idx);
+}
+
+int CubieCube::get_slice_sorted() const { return get_edge4(ep.data(), FR); }
+
+void CubieCube::set_slice_sorted(int idx) {
+  uint8_t slice_edge[4] = {FR, FL, BL, BR};
+  const uint8_t other_edge[8] = {UR, UF, UL, UB, DR, DF, DL, DB};
+  permute_edge4(slice_edge, idx % 24);
+  set_edge4(ep, slice_edge, other_edge, idx / 24);
+}
+
+int CubieCube::get_u_edges() const {
+  std::array<uint8_t, 12> ep_mod = ep;
+  for (int j = 0; j < 4; j++) rotate_right(ep_mod.data(), 0, 11);
+  return get_edge4(ep_mod.data(), UR);
+}
+
+void CubieCube::set_u_edges(int idx) {
+  uint8_t slice_edge[4] = {UR, UF, UL, UB};
+  const uint8_t other_edge[8] = {DR, DF, DL, DB, FR, FL, BL, BR};
+  permute_edge4(slice_edge, idx % 24);
+  set_edge4(ep, slice_edge, other_edge, idx / 24);
+  for (int j = 0; j < 4; j++) rotate_left(ep.data(), 0, 11);
+}
+
+int CubieCube::get_d_edges() const {
+  std::array<uint8_t, 12> ep_mod = ep;
+  for (int j = 0; j < 4; j++) rotate_right(ep_mod.data(), 0, 11);
+  return get_edge4(ep_mod.data(), DR);
+}
+
+void CubieCube::set_d_edges(int idx) {
+  uint8_t slice_edge[4] = {DR, DF, DL, DB};
+  const uint8_t other_edge[8] = {FR, FL, BL, BR, UR, UF, UL, UB};
+  permute_edge4(slice_edge, idx % 24);
+  set_edge4(ep, slice_edge, other_edge, idx / 24);
+  for (int j = 0; j < 4; j++) rotate_left(ep.data(), 0, 11);
+}
+
+int CubieCube::get_corners() const {
+  std::array<uint8_t, 8> perm = cp;
+  int b = 0;
+  for (int j = DRB; j > URF; j--) {
+    int k = 0;
+    while (perm[j] != j) {
+      rotate_left(perm.data(), 0, j);
+      k++;
+    }
+    b = (j + 1) * b + k;
+  }
+  return b;
+}
+
+void CubieCube::set_corners(int idx) {
+  for (int i = URF; i <= DRB; i++) cp[i] = uint8_t(i);
+  for (int j = URF; j <= DRB; j++) {
+    int k = idx % (j + 1);
+    idx /= j + 1;
+    while (k-- > 0) rotate_right(cp.data(), 0, j);
+  }
+}
+
+int CubieCube::get_ud_edges() const {
+  uint8_t perm[8];
+  for (int i = 0; i < 8; i++) perm[i] = ep[i];
+  int b = 0;
+  for (int j = DB; j > UR; j--) {
+    int k = 0;
+    while (perm[j] != j) {
+      rotate_left(perm, 0, j);
+      k++;
+    }
+    b = (j + 1) * b + k;
+  }
+  return b;
+}
+
+void CubieCube::set_ud_edges(int idx) {
+  // positions of FR FL BL BR edges are not affected
+  for (int i = UR; i <= DB; i++) ep[i] = uint8_t(i);
+  for (int j = UR; j <= DB; j++) {
+    int k = idx % (j + 1);
+    idx /= j + 1;
+    while (k-- > 0) rotate_right(ep.data(), 0, j);
+  }
+}
+
+// ############################################ other usefull functions #################################################
+void CubieCube::set_edges(int64_t idx) {
+  // The permutation of the 12 edges. 0 <= idx < 12!.
+  for (int i = UR; i <= BR; i++) ep[i] = uint8_t(i);
+  for (int j = UR; j <= BR; j++) {
+    int k = int(idx % (j + 1));
+    idx /= j + 1;
+    while (k-- > 0) rotate_right(ep.data(), 0, j);
+  }
+}
+
+std::string CubieCube::verify() const {
+  int edge_count[12] = {};
+  for (int i = UR; i <= BR; i++) {
+    if (ep[i] >= 12) return "Error: Some edges are undefined.";
+    edge_count[ep[i]]++;
+  }
+  for (int i = UR; i <= BR; i++)
+    if (edge_count[i] != 1) return "Error: Some edges are undefined.";
+
+  int s = 0;
+  for (int i = UR; i <= BR; i++) s += eo[i];
+  if (s % 2 != 0) return "Error: Total edge flip is wrong.";
+
+  int corner_count[8] = {};
+  for (int i = URF; i <= DRB; i++) {
+    if (cp[i] >= 8) return "Error: Some corners are undefined.";
+    corner_count[cp[i]]++;
+  }
+  for (int i = URF; i <= DRB; i++)
+    if (corner_count[i] != 1) return "Error: Some corners are undefined.";
+
+  s = 0;
+  for (int i = URF; i <= DRB; i++) s += co[i];
+  if (s % 3 != 0) return "Error: Total corner twist is wrong.";
+
+  if (edge_parity() != corner_parity()) return "Error: Wrong edge and corner parity";
+  return "";
+}
+
+}  // namespace twophase
@@ -0,0 +1,205 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "defs.hpp"
+
+// ####### The cube on the cubie level is described by the permutation and orientations of corners and edges ############
+// Mirrors kociemba/cubie.py.
+
+namespace twophase {
+
+struct FaceCube;
+
+// Represent a cube on the cubie level with 8 corner cubies, 12 edge cubies and the cubie orientations.
+// Is also used to represent the 18 cube moves and the 48 symmetries of the cube. Corner orientations >= 3 denote a
+// mirrored state, see corner_multiply().
+struct CubieCube {
+  std::array<uint8_t, 8> cp = {URF, UFL, ULB, UBR, DFR, DLF, DBL, DRB};  // corner permutation
+  std::array<uint8_t, 8> co = {};  // corner orientation
+  std::array<uint8_t, 12> ep = {UR, UF, UL, UB, DR, DF, DL, DB, FR, FL, BL, BR};  // edge permutation
+  std::array<uint8_t, 12> eo = {};  // edge orientation
+
+  bool operator==(const CubieCube&) const = default;
+
+  std::string to_string() const;
+  FaceCube to_facelet_cube() const;
+
+  // Multiply this cubie cube with another cubie cube b, restricted to the corners. Does not change b.
+  constexpr void corner_multiply(const CubieCube& b);
+  // Multiply this cubie cube with another cubiecube b, restricted to the edges. Does not change b.
+  constexpr void edge_multiply(const CubieCube& b);
+  constexpr void multiply(const CubieCube& b);
+  // Store the inverse of this cubie cube in d.
+  void inv_cubie_cube(CubieCube& d) const;
+
+  int corner_parity() const;
+  // A solvable cube has the same corner and edge parity.
+  int edge_parity() const;
+  // The symmetries and antisymmetries (index + N_SYM) of the cubie cube.
+  std::vector<int> symmetries() const;
+
+  // ###################################### coordinates for phase 1 and 2 ###############################################
+  constexpr int get_twist() const;  // 0 <= twist < 2187 in phase 1, twist = 0 in phase 2
+  constexpr void set_twist(int twist);
+  constexpr int get_flip() const;  // 0 <= flip < 2048 in phase 1, flip = 0 in phase 2
+  constexpr void set_flip(int flip);
+  int get_slice() const;  // 0 <= slice < 495 in phase 1, slice = 0 in phase 2
+  void set_slice(int idx);
+  int get_slice_sorted() const;  // 0 <= slice_sorted < 11880 in phase 1, < 24 in phase 2
+  void set_slice_sorted(int idx);
+  int get_u_edges() const;  // 0 <= u_edges < 11880 in phase 1, < 1680 in phase 2, 1656 for solved cube
+  void set_u_edges(int idx);
+  int get_d_edges() const;  // 0 <= d_edges < 11880 in phase 1, < 1680 in phase 2, 0 for solved cube
+  void set_d_edges(int idx);
+  int get_corners() const;  // 0 <= corners < 40320
+  void set_corners(int idx);
+  int get_ud_edges() const;  // undefined in phase 1, 0 <= ud_edges < 40320 in phase 2
+  void set_ud_edges(int idx);
+
+  // ############################################ other usefull functions ###############################################
+  // Generate a random cube. The probability is the same for all possible states.
+  template <typename Rng>
+  void randomize(Rng& rng);
+  // Check if cubiecube is valid. Returns an empty string for a valid cube, else the error message.
+  std::string verify() const;
+
+private:
+  void set_edges(int64_t idx);
+};
+
+constexpr void CubieCube::corner_multiply(const CubieCube& b) {
+  std::array<uint8_t, 8> c_perm{}, c_ori{};
+  for (int c = URF; c <= DRB; c++) {
+    c_perm[c] = cp[b.cp[c]];
+    int ori_a = co[b.cp[c]];
+    int ori_b = b.co[c];
+    int ori = 0;
+    if (ori_a < 3 && ori_b < 3) {  // two regular cubes
+      ori = ori_a + ori_b;
+      if (ori >= 3) ori -= 3;
+    } else if (ori_a < 3 && 3 <= ori_b) {  // cube b is in a mirrored state
+      ori = ori_a + ori_b;
+      if (ori >= 6) ori -= 3;  // the composition also is in a mirrored state
+    } else if (ori_a >= 3 && 3 > ori_b) {  // cube a is in a mirrored state
+      ori = ori_a - ori_b;
+      if (ori < 3) ori += 3;  // the composition is a mirrored cube
+    } else {  // if both cubes are in mirrored states
+      ori = ori_a - ori_b;
+      if (ori < 0) ori += 3;  // the composition is a regular cube
+    }
+    c_ori[c] = uint8_t(ori);
+  }
+  cp = c_perm;
+  co = c_ori;
+}
+
+constexpr void CubieCube::edge_multiply(const CubieCube& b) {
+  std::array<uint8_t, 12> e_perm{}, e_ori{};
+  for (int e = UR; e <= BR; e++) {
+    e_perm[e] = ep[b.ep[e]];
+    e_ori[e] = uint8_t((b.eo[e] + eo[b.ep[e]]) % 2);
+  }
+  ep = e_perm;
+  eo = e_ori;
+}
+
+constexpr void CubieCube::multiply(const CubieCube& b) {
+  corner_multiply(b);
+  edge_multiply(b);
+}
+
+constexpr int CubieCube::get_twist() const {
+  int ret = 0;
+  for (int i = URF; i < DRB; i++) ret = 3 * ret + co[i];
+  return ret;
+}
+
+constexpr void CubieCube::set_twist(int twist) {
+  int twistparity = 0;
+  for (int i = DRB - 1; i >= URF; i--) {
+    co[i] = uint8_t(twist % 3);
+    twistparity += co[i];
+    twist /= 3;
+  }
+  co[DRB] = uint8_t((3 - twistparity % 3) % 3);
+}
+
+constexpr int CubieCube::get_flip() const {
+  int ret = 0;
+  for (int i = UR; i < BR; i++) ret = 2 * ret + eo[i];
+  return ret;
+}
+
+constexpr void CubieCube::set_flip(int flip) {
+  int flipparity = 0;
+  for (int i = BR - 1; i >= UR; i--) {
+    eo[i] = uint8_t(flip % 2);
+    flipparity += eo[i];
+    flip /= 2;
+  }
+  eo[BR] = uint8_t((2 - flipparity % 2) % 2);
+}
+
+// ################## The basic six cube moves described by permutations and changes in orientation #####################
+// Up-move
+inline constexpr CubieCube cube_U = {{UBR, URF, UFL, ULB, DFR, DLF, DBL, DRB},
+                                     {0, 0, 0, 0, 0, 0, 0, 0},
+                                     {UB, UR, UF, UL, DR, DF, DL, DB, FR, FL, BL, BR},
+                                     {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}};
+// Right-move
+inline constexpr CubieCube cube_R = {{DFR, UFL, ULB, URF, DRB, DLF, DBL, UBR},
+                                     {2, 0, 0, 1, 1, 0, 0, 2},
+                                     {FR, UF, UL, UB, BR, DF, DL, DB, DR, FL, BL, UR},
+                                     {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}};
+// Front-move
+inline constexpr CubieCube cube_F = {{UFL, DLF, ULB, UBR, URF, DFR, DBL, DRB},
+                                     {1, 2, 0, 0, 2, 1, 0, 0},
+                                     {UR, FL, UL, UB, DR, FR, DL, DB, UF, DF, BL, BR},
+                                     {0, 1, 0, 0, 0, 1, 0, 0, 1, 1, 0, 0}};
+// Down-move
+inline constexpr CubieCube cube_D = {{URF, UFL, ULB, UBR, DLF, DBL, DRB, DFR},
+                                     {0, 0, 0, 0, 0, 0, 0, 0},
+                                     {UR, UF, UL, UB, DF, DL, DB, DR, FR, FL, BL, BR},
+                                     {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}};
+// Left-move
+inline constexpr CubieCube cube_L = {{URF, ULB, DBL, UBR, DFR, UFL, DLF, DRB},
+                                     {0, 1, 2, 0, 0, 2, 1, 0},
+                                     {UR, UF, BL, UB, DR, DF, FL, DB, FR, UL, DL, BR},
+                                     {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}};
+// Back-move
+inline constexpr CubieCube cube_B = {{URF, UFL, UBR, DRB, DFR, DLF, ULB, DBL},
+                                     {0, 0, 1, 2, 0, 0, 2, 1},
+                                     {UR, UF, UL, BR, DR, DF, DL, BL, FR, FL, UB, DB},
+                                     {0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 1, 1}};
+
+inline constexpr CubieCube basicMoveCube[6] = {cube_U, cube_R, cube_F, cube_D, cube_L, cube_B};
+
+// ################################# these cubes represent the all 18 cube moves ########################################
+inline constexpr std::array<CubieCube, N_MOVE> moveCube = [] {
+  std::array<CubieCube, N_MOVE> ret;
+  for (int c1 = 0; c1 < 6; c1++) {
+    CubieCube cc;
+    for (int k1 = 0; k1 < 3; k1++) {
+      cc.multiply(basicMoveCube[c1]);
+      ret[3 * c1 + k1] = cc;
+    }
+  }
+  return ret;
+}();
+
+template <typename Rng>
+void CubieCube::randomize(Rng& rng) {
+  auto randrange = [&rng](int64_t n) { return int64_t(rng() % uint64_t(n)); };
+  set_edges(randrange(479001600));  // 12!
+  int p = edge_parity();
+  do {
+    set_corners(int(randrange(40320)));  // 8!
+  } while (p != corner_parity());  // parities of edge and corner permutations must be the same
+  set_flip(int(randrange(2048)));  // 2^11
+  set_twist(int(randrange(2187)));  // 3^7
+}
+
+}  // namespace twophase
@@ -0,0 +1,47 @@
+#pragma once
+#include "enums.hpp"
+
+// ###################################### some definitions and constants ################################################
+// Mirrors kociemba/defs.py.
+
+namespace twophase {
+
+// Map the corner positions to facelet positions.
+inline constexpr uint8_t cornerFacelet[8][3] = {
+    {Fc::U9, Fc::R1, Fc::F3}, {Fc::U7, Fc::F1, Fc::L3}, {Fc::U1, Fc::L1, Fc::B3}, {Fc::U3, Fc::B1, Fc::R3},
+    {Fc::D3, Fc::F9, Fc::R7}, {Fc::D1, Fc::L9, Fc::F7}, {Fc::D7, Fc::B9, Fc::L7}, {Fc::D9, Fc::R9, Fc::B7}};
+
+// Map the edge positions to facelet positions.
+inline constexpr uint8_t edgeFacelet[12][2] = {{Fc::U6, Fc::R2}, {Fc::U8, Fc::F2}, {Fc::U4, Fc::L2}, {Fc::U2, Fc::B2},
+                                               {Fc::D6, Fc::R8}, {Fc::D2, Fc::F8}, {Fc::D4, Fc::L8}, {Fc::D8, Fc::B8},
+                                               {Fc::F6, Fc::R4}, {Fc::F4, Fc::L6}, {Fc::B6, Fc::L4}, {Fc::B4, Fc::R6}};
+
+// Map the corner positions to facelet colors.
+inline constexpr Color cornerColor[8][3] = {{U, R, F}, {U, F, L}, {U, L, B}, {U, B, R},
+                                            {D, F, R}, {D, L, F}, {D, B, L}, {D, R, B}};
+
+// Map the edge positions to facelet colors.
+inline constexpr Color edgeColor[12][2] = {{U, R}, {U, F}, {U, L}, {U, B}, {D, R}, {D, F},
+                                           {D, L}, {D, B}, {F, R}, {F, L}, {B, L}, {B, R}};
+
+// ###################################### some "constants" ##############################################################
+inline constexpr int N_PERM_4 = 24;
+inline constexpr int N_CHOOSE_8_4 = 70;
+inline constexpr int N_MOVE = 18;  // number of possible face moves
+
+inline constexpr int N_TWIST = 2187;  // 3^7 possible corner orientations in phase 1
+inline constexpr int N_FLIP = 2048;  // 2^11 possible edge orientations in phase 1
+inline constexpr int N_SLICE_SORTED = 11880;  // 12*11*10*9 possible positions of the FR, FL, BL, BR edges in phase 1
+inline constexpr int N_SLICE = N_SLICE_SORTED / N_PERM_4;  // we ignore the permutation of FR, FL, BL, BR in phase 1
+inline constexpr int N_FLIPSLICE_CLASS = 64430;  // number of equivalence classes for combined flip+slice
+
+inline constexpr int N_U_EDGES_PHASE2 = 1680;  // number of different positions of the edges UR, UF, UL, UB in phase 2
+inline constexpr int N_CORNERS = 40320;  // 8! corner permutations in phase 2
+inline constexpr int N_CORNERS_CLASS = 2768;  // number of equivalence classes concerning symmetry group D4h
+inline constexpr int N_UD_EDGES = 40320;  // 8! permutations of the edges in the U-face and D-face in phase 2
+
+inline constexpr int N_SYM = 48;  // number of cube symmetries of full group Oh
+inline constexpr int N_SYM_D4h = 16;  // Number of symmetries of subgroup D4h
+inline constexpr const char* FOLDER = "precomputed";  // Folder name for generated tables, shared with kociemba/
+
+}  // namespace twophase
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+
+//  ####################  Enumerations which improve the readability of the code ########################################
+// Mirrors kociemba/enums.py. The enums are unscoped on purpose: the coordinate code does a lot of arithmetic with them.
+
+namespace twophase {
+
+// The names of the facelet positions of the cube, see kociemba/enums.py for the layout.
+// A cube definition string lists the facelets in the order U1..U9, R1..R9, F1..F9, D1..D9, L1..L9, B1..B9.
+struct Fc {
+  enum : uint8_t {
+    U1, U2, U3, U4, U5, U6, U7, U8, U9,
+    R1, R2, R3, R4, R5, R6, R7, R8, R9,
+    F1, F2, F3, F4, F5, F6, F7, F8, F9,
+    D1, D2, D3, D4, D5, D6, D7, D8, D9,
+    L1, L2, L3, L4, L5, L6, L7, L8, L9,
+    B1, B2, B3, B4, B5, B6, B7, B8, B9
+  };
+};
+
+// The possible colors of the cube facelets. Color U refers to the color of the U(p)-face etc.
+// Also used to name the faces itself.
+enum Color : uint8_t { U, R, F, D, L, B };
+
+// The names of the corner positions of the cube. Corner URF e.g. has an U(p), a R(ight) and a F(ront) facelet.
+enum Corner : uint8_t { URF, UFL, ULB, UBR, DFR, DLF, DBL, DRB };
+
+// The names of the edge positions of the cube. Edge UR e.g. has an U(p) and R(ight) facelet.
+enum Edge : uint8_t { UR, UF, UL, UB, DR, DF, DL, DB, FR, FL, BL, BR };
+
+// The moves in the faceturn metric. Not to be confused with the names of the facelet positions in Fc.
+enum Move : uint8_t { U1, U2, U3, R1, R2, R3, F1, F2, F3, D1, D2, D3, L1, L2, L3, B1, B2, B3 };
+
+// Basic symmetries of the cube. All 48 cube symmetries can be generated by sequences of these 4 symmetries.
+enum BS : uint8_t { ROT_URF3, ROT_F2, ROT_U4, MIRR_LR2 };
+
+// Printable names of the moves, the same as Move.name in kociemba/enums.py.
+inline constexpr const char* move_name[18] = {"U1", "U2", "U3", "R1", "R2", "R3", "F1", "F2", "F3",
+                                              "D1", "D2", "D3", "L1", "L2", "L3", "B1", "B2", "B3"};
+
+}  // namespace twophase
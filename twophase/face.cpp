@@ -0,0 +1,82 @@
+#include "face.hpp"
+
+namespace twophase {
+
+namespace {
+
+constexpr char color_char[6] = {'U', 'R', 'F', 'D', 'L', 'B'};
+
+}  // namespace
+
+std::string FaceCube::from_string(const std::string& s) {
+  if (s.size() < 54) return "Error: Cube definition string " + s + " contains less than 54 facelets.";
+  if (s.size() > 54) return "Error: Cube definition string " + s + " contains more than 54 facelets.";
+  int cnt[6] = {};
+  for (int i = 0; i < 54; i++) {
+    for (int c = U; c <= B; c++) {
+      if (s[i] == color_char[c]) {
+        f[i] = uint8_t(c);
+        cnt[c]++;
+      }
+    }
+  }
+  for (int c = U; c <= B; c++)
+    if (cnt[c] != 9)
+      return "Error: Cube definition string " + s + " does not contain exactly 9 facelets of each color.";
+  return "";
+}
+
+std::string FaceCube::to_string() const {
+  std::string s(54, ' ');
+  for (int i = 0; i < 54; i++) s[i] = color_char[f[i]];
+  return s;
+}
+
+std::string FaceCube::to_2dstring() const {
+  std::string s = to_string();
+  std::string r = "   " + s.substr(0, 3) + "\n   " + s.substr(3, 3) + "\n   " + s.substr(6, 3) + "\n";
+  r += s.substr(36, 3) + s.substr(18, 3) + s.substr(9, 3) + s.substr(45, 3) + "\n" + s.substr(39, 3) +
+       s.substr(21, 3) + s.substr(12, 3) + s.substr(48, 3) + "\n" + s.substr(42, 3) + s.substr(24, 3) +
+       s.substr(15, 3) + s.substr(51, 3) + "\n";
+  r += "   " + s.substr(27, 3) + "\n   " + s.substr(30, 3) + "\n   " + s.substr(33, 3) + "\n";
+  return r;
+}
+
+CubieCube FaceCube::to_cubie_cube() const {
+  CubieCube cc;
+  cc.cp.fill(0xff);  // invalidate corner and edge permutation
+  cc.ep.fill(0xff);
+  for (int i = URF; i <= DRB; i++) {
+    const uint8_t* fac = cornerFacelet[i];  // facelets of corner  at position i
+    int ori = 0;
+    for (ori = 0; ori < 3; ori++)
+      if (f[fac[ori]] == U || f[fac[ori]] == D) break;
+    if (ori == 3) ori = 2;  // no U or D facelet, leave the corner undefined like kociemba/face.py does
+    int col1 = f[fac[(ori + 1) % 3]];  // colors which identify the corner at position i
+    int col2 = f[fac[(ori + 2) % 3]];
+    for (int j = URF; j <= DRB; j++) {
+      if (col1 == cornerColor[j][1] && col2 == cornerColor[j][2]) {
+        cc.cp[i] = uint8_t(j);  // we have corner j in corner position i
+        cc.co[i] = uint8_t(ori);
+        break;
+      }
+    }
+  }
+  for (int i = UR; i <= BR; i++) {
+    for (int j = UR; j <= BR; j++) {
+      if (f[edgeFacelet[i][0]] == edgeColor[j][0] && f[edgeFacelet[i][1]] == edgeColor[j][1]) {
+        cc.ep[i] = uint8_t(j);
+        cc.eo[i] = 0;
+        break;
+      }
+      if (f[edgeFacelet[i][0]] == edgeColor[j][1] && f[edgeFacelet[i][1]] == edgeColor[j][0]) {
+        cc.ep[i] = uint8_t(j);
+        cc.eo[i] = 1;
+        break;
+      }
+    }
+  }
+  return cc;
+}
+
+}  // namespace twophase
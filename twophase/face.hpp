@@ -0,0 +1,27 @@
+#pragma once
+#include <array>
+#include <string>
+
+#include "cubie.hpp"
+
+// ####### The cube on the facelet level is described by positions of the colored stickers. #############################
+// Mirrors kociemba/face.py.
+
+namespace twophase {
+
+// Represent a cube on the facelet level with 54 colored facelets.
+struct FaceCube {
+  std::array<uint8_t, 54> f = {U, U, U, U, U, U, U, U, U, R, R, R, R, R, R, R, R, R, F, F, F, F, F, F, F, F, F,
+                               D, D, D, D, D, D, D, D, D, L, L, L, L, L, L, L, L, L, B, B, B, B, B, B, B, B, B};
+
+  // Construct a facelet cube from a string. Returns an empty string on success, else the error message.
+  std::string from_string(const std::string& s);
+  // Give a string representation of the facelet cube.
+  std::string to_string() const;
+  // Give a 2dstring representation of a facelet cube.
+  std::string to_2dstring() const;
+  // Return a cubie representation of the facelet cube.
+  CubieCube to_cubie_cube() const;
+};
+
+}  // namespace twophase
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+
+// ######################################## Miscellaneous functions #####################################################
+
+namespace twophase {
+
+// Rotate array arr right between left and right. right is included.
+template <typename T>
+constexpr void rotate_right(T* arr, int left, int right) {
+  T temp = arr[right];
+  for (int i = right; i > left; i--) arr[i] = arr[i - 1];
+  arr[left] = temp;
+}
+
+// Rotate array arr left between left and right. right is included.
+template <typename T>
+constexpr void rotate_left(T* arr, int left, int right) {
+  T temp = arr[left];
+  for (int i = left; i < right; i++) arr[i] = arr[i + 1];
+  arr[right] = temp;
+}
+
+// Binomial coefficient [n choose k].
+constexpr int c_nk(int n, int k) {
+  if (n < k) return 0;
+  if (k > n / 2) k = n - k;
+  int s = 1;
+  for (int i = n, j = 1; i != n - k; i--, j++) {
+    s *= i;
+    s /= j;
+  }
+  return s;
+}
+
+}  // namespace twophase
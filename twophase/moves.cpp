@@ -0,0 +1,134 @@
+#include "moves.hpp"
+
+#include <vector>
+
+#include "cubie.hpp"
+
+namespace twophase::mv {
+
+Table<uint16_t> slice_sorted_move;
+Table<uint16_t> u_edges_move;
+Table<uint16_t> d_edges_move;
+Table<uint16_t> ud_edges_move;
+Table<uint16_t> corners_move;
+
+namespace {
+
+// Build the move table of a coordinate with n values. The 4th move of each face restores the cubie cube.
+// Entries of moves m with skip(m) are left 0.
+template <typename Set, typename Get, typename Multiply>
+std::vector<uint16_t> create_move_table(int n, Set set, Get get, Multiply multiply,
+                                        bool (*skip)(int) = [](int) { return false; }) {
+  std::vector<uint16_t> table(size_t(n) * N_MOVE);
+  CubieCube a;
+  for (int i = 0; i < n; i++) {
+    set(a, i);
+    for (int j = U; j <= B; j++) {  // six faces U, R, F, D, L, B
+      for (int k = 0; k < 3; k++) {  // three moves for each face, for example U, U2, U3 = U'
+        multiply(a, basicMoveCube[j]);
+        if (!skip(3 * j + k)) table[N_MOVE * i + 3 * j + k] = uint16_t(get(a));
+      }
+      multiply(a, basicMoveCube[j]);  // 4. move restores face
+    }
+  }
+  return table;
+}
+
+constexpr auto corner_mult = [](CubieCube& a, const CubieCube& b) { a.corner_multiply(b); };
+constexpr auto edge_mult = [](CubieCube& a, const CubieCube& b) { a.edge_multiply(b); };
+
+}  // namespace
+
+// ############################ Move tables for the twist and the flip, created at compile time #########################
+// The orientations are updated directly, co'[c] = co[cp_m[c]] + co_m[c] mod 3 for a move m, which is what
+// corner_multiply() does for regular cubes. The compiler evaluates plain arrays much faster than the std::array members
+// of CubieCube, going through cubie cubes takes it minutes.
+
+namespace {
+
+struct MoveArrays {
+  uint8_t cp[N_MOVE][8], co[N_MOVE][8], ep[N_MOVE][12], eo[N_MOVE][12];
+};
+
+constexpr MoveArrays move_arrays() {
+  MoveArrays ret{};
+  for (int m = 0; m < N_MOVE; m++) {
+    for (int c = URF; c <= DRB; c++) {
+      ret.cp[m][c] = moveCube[m].cp[c];
+      ret.co[m][c] = moveCube[m].co[c];
+    }
+    for (int e = UR; e <= BR; e++) {
+      ret.ep[m][e] = moveCube[m].ep[e];
+      ret.eo[m][e] = moveCube[m].eo[e];
+    }
+  }
+  return ret;
+}
+
+}  // namespace
+
+constexpr std::array<uint16_t, N_TWIST * N_MOVE> twist_move = [] {
+  std::array<uint16_t, N_TWIST * N_MOVE> ret{};
+  const MoveArrays mc = move_arrays();
+  for (int t = 0; t < N_TWIST; t++) {
+    CubieCube a;
+    a.set_twist(t);
+    uint8_t co[8] = {};
+    for (int c = URF; c <= DRB; c++) co[c] = a.co[c];
+    for (int m = 0; m < N_MOVE; m++) {
+      int twist = 0;
+      for (int c = URF; c < DRB; c++) twist = 3 * twist + (co[mc.cp[m][c]] + mc.co[m][c]) % 3;
+      ret[N_MOVE * t + m] = uint16_t(twist);
+    }
+  }
+  return ret;
+}();
+
+constexpr std::array<uint16_t, N_FLIP * N_MOVE> flip_move = [] {
+  std::array<uint16_t, N_FLIP * N_MOVE> ret{};
+  const MoveArrays mc = move_arrays();
+  for (int f = 0; f < N_FLIP; f++) {
+    CubieCube a;
+    a.set_flip(f);
+    uint8_t eo[12] = {};
+    for (int e = UR; e <= BR; e++) eo[e] = a.eo[e];
+    for (int m = 0; m < N_MOVE; m++) {
+      int flip = 0;
+      for (int e = UR; e < BR; e++) flip = 2 * flip + (eo[mc.ep[m][e]] + mc.eo[m][e]) % 2;
+      ret[N_MOVE * f + m] = uint16_t(flip);
+    }
+  }
+  return ret;
+}();
+
+void init() {
+  slice_sorted_move = load_or_create<uint16_t>("move_slice_sorted", N_SLICE_SORTED * N_MOVE, [] {
+    return create_move_table(
+        N_SLICE_SORTED, [](CubieCube& a, int i) { a.set_slice_sorted(i); },
+        [](const CubieCube& a) { return a.get_slice_sorted(); }, edge_mult);
+  });
+  u_edges_move = load_or_create<uint16_t>("move_u_edges", N_SLICE_SORTED * N_MOVE, [] {
+    return create_move_table(
+        N_SLICE_SORTED, [](CubieCube& a, int i) { a.set_u_edges(i); },
+        [](const CubieCube& a) { return a.get_u_edges(); }, edge_mult);
+  });
+  d_edges_move = load_or_create<uint16_t>("move_d_edges", N_SLICE_SORTED * N_MOVE, [] {
+    return create_move_table(
+        N_SLICE_SORTED, [](CubieCube& a, int i) { a.set_d_edges(i); },
+        [](const CubieCube& a) { return a.get_d_edges(); }, edge_mult);
+  });
+  ud_edges_move = load_or_create<uint16_t>("move_ud_edges", N_UD_EDGES * N_MOVE, [] {
+    // only R2, F2, L2 and B2 in phase 2, the other quarter turns would move the ud edges out of the U and D face
+    return create_move_table(
+        N_UD_EDGES, [](CubieCube& a, int i) { a.set_ud_edges(i); },
+        [](const CubieCube& a) { return a.get_ud_edges(); }, edge_mult,
+        [](int m) { return m / 3 != U && m / 3 != D && m % 3 != 1; });
+  });
+  corners_move = load_or_create<uint16_t>("move_corners", N_CORNERS * N_MOVE, [] {
+    return create_move_table(
+        N_CORNERS, [](CubieCube& a, int i) { a.set_corners(i); }, [](const CubieCube& a) { return a.get_corners(); },
+        corner_mult);
+  });
+}
+
+}  // namespace twophase::mv
@@ -0,0 +1,26 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+#include "defs.hpp"
+#include "tables.hpp"
+
+// ################### Movetables describe the transformation of the coordinates by cube moves. #########################
+// Mirrors kociemba/moves.py. All tables are indexed by N_MOVE * coordinate + move.
+
+namespace twophase::mv {
+
+// The small tables are created by the compiler and are part of the read-only data of the program.
+extern const std::array<uint16_t, N_TWIST * N_MOVE> twist_move;  // 0 <= twist < 2187 in phase 1, twist = 0 in phase 2
+extern const std::array<uint16_t, N_FLIP * N_MOVE> flip_move;  // 0 <= flip < 2048 in phase 1, flip = 0 in phase 2
+
+extern Table<uint16_t> slice_sorted_move;  // 0 <= slice_sorted < 11880 in phase 1, < 24 in phase 2
+extern Table<uint16_t> u_edges_move;  // 0 <= u_edges < 11880 in phase 1, < 1680 in phase 2
+extern Table<uint16_t> d_edges_move;  // 0 <= d_edges < 11880 in phase 1, < 1680 in phase 2
+extern Table<uint16_t> ud_edges_move;  // only phase 2 moves are valid, 0 <= ud_edges < 40320
+extern Table<uint16_t> corners_move;  // 0 <= corners < 40320
+
+// Load the other move tables from FOLDER or create them.
+void init();
+
+}  // namespace twophase::mv
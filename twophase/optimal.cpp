@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#include "cache.hpp"
+#include "coord.hpp"
+#include "face.hpp"
+#include "moves.hpp"
+#include "pruning.hpp"
+#include "solver.hpp"
+#include "symmetries.hpp"
+#include "thread_pool.hpp"
+
+// ################### Optimal solver, IDA* with the lower bounds of the cube seen along all three axes ################
+// A maneuver needs at least as many moves as it takes to bring the cube into the phase 1 subgroup H, and at least as
+// many as it takes to solve flip, slice and the corner permutation. Both distances are taken for the cube and for the
+// cube rotated by 120° and 240° along the long diagonal, so that the UD, RL and FB slices all count. The largest of
+// these six values prunes the search.
+
+namespace twophase {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+inline uint64_t nanoseconds(Clock::duration d) {
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+}
+
+// The search tree is split into subtrees at this depth, or less if the bound is smaller.
+constexpr int SPLIT_DEPTH = 3;
+
+// The coordinates of the cube along one axis, the cube rotated by 120° * rot.
+struct Axis {
+  int flip, twist, slice_sorted, corners;
+  int dist_h;  // distance to subgroup H
+  int dist_c;  // distance to solved flip, slice and corner permutation
+};
+
+struct Node {
+  Axis axis[3];
+  int u_edges, d_edges;  // with slice_sorted of axis 0 they give the edge permutation of the cube
+  int bound() const {
+    int h = 0;
+    for (const Axis& a : axis) h = std::max({h, a.dist_h, a.dist_c});
+    return h;
+  }
+  bool solved() const {
+    const Axis& a = axis[0];
+    return a.flip == 0 && a.twist == 0 && a.slice_sorted == 0 && a.corners == 0 && u_edges == 1656 && d_edges == 0;
+  }
+};
+
+// The move m of the cube is the move conj[rot][m] of the cube rotated by 120° * rot.
+const auto conj = [] {
+  std::array<std::array<uint8_t, N_MOVE>, 3> ret{};
+  for (int m = 0; m < N_MOVE; m++) {
+    ret[0][m] = uint8_t(m);
+    ret[1][m] = sy::conj_move[N_MOVE * 32 + m];
+    ret[2][m] = sy::conj_move[N_MOVE * 16 + m];
+  }
+  return ret;
+}();
+
+inline uint32_t flipslice_corners_index(int flip, int slice_sorted, int corners) {
+  int flipslice = N_FLIP * (slice_sorted / N_PERM_4) + flip;
+  return uint32_t(N_CORNERS) * sy::flipslice_classidx[flipslice] +
+         sy::corners_conj[(corners << 4) + sy::flipslice_sym[flipslice]];
+}
+
+inline uint32_t flipslice_twist_index(int flip, int slice_sorted, int twist) {
+  int flipslice = N_FLIP * (slice_sorted / N_PERM_4) + flip;
+  return uint32_t(N_TWIST) * sy::flipslice_classidx[flipslice] +
+         sy::twist_conj[(twist << 4) + sy::flipslice_sym[flipslice]];
+}
+
+// Distance to solved flip, slice and corner permutation, like CoordCube::get_depth_phase1().
+int get_depth_flipslice_corners(int flip, int slice_sorted, int corners) {
+  int depth_mod3 = int(pr::get_flipslice_corners_depth3(flipslice_corners_index(flip, slice_sorted, corners)));
+  int depth = 0;
+  while (flip != SOLVED || slice_sorted / N_PERM_4 != SOLVED || corners != SOLVED) {
+    if (depth_mod3 == 0) depth_mod3 = 3;
+    for (int m = 0; m < N_MOVE; m++) {
+      int flip1 = mv::flip_move[N_MOVE * flip + m];
+      int slice1 = mv::slice_sorted_move[N_MOVE * slice_sorted + m];
+      int corners1 = mv::corners_move[N_MOVE * corners + m];
+      if (int(pr::get_flipslice_corners_depth3(flipslice_corners_index(flip1, slice1, corners1))) == depth_mod3 - 1) {
+        depth++;
+        flip = flip1;
+        slice_sorted = slice1;
+        corners = corners1;
+        depth_mod3--;
+        break;
+      }
+    }
+  }
+  return depth;
+}
+
+// Successive moves on the same face or on the same axis in the wrong order are redundant.
+inline bool redundant(int last, int m) {
+  int diff = last / 3 - m / 3;
+  return diff == 0 || diff == 3;
+}
+
+// The node after move m, or false if it needs togo or more moves. The axes are computed one after the other and the
+// first bound which is too large ends it, most children are pruned after a few table lookups.
+inline bool child(const Node& n, int m, int togo, Node& c) {
+  for (int r = 0; r < 3; r++) {
+    const Axis& a = n.axis[r];
+    Axis& b = c.axis[r];
+    int mr = conj[r][m];
+    b.flip = mv::flip_move[N_MOVE * a.flip + mr];
+    b.slice_sorted = mv::slice_sorted_move[N_MOVE * a.slice_sorted + mr];
+    b.corners = mv::corners_move[N_MOVE * a.corners + mr];
+    uint32_t c3 = pr::get_flipslice_corners_depth3(flipslice_corners_index(b.flip, b.slice_sorted, b.corners));
+    b.dist_c = pr::distance[3 * a.dist_c + c3];
+    if (b.dist_c >= togo) return false;
+    b.twist = mv::twist_move[N_MOVE * a.twist + mr];
+    uint32_t h3 = pr::get_flipslice_twist_depth3(flipslice_twist_index(b.flip, b.slice_sorted, b.twist));
+    b.dist_h = pr::distance[3 * a.dist_h + h3];
+    if (b.dist_h >= togo) return false;
+  }
+  c.u_edges = mv::u_edges_move[N_MOVE * n.u_edges + m];
+  c.d_edges = mv::d_edges_move[N_MOVE * n.d_edges + m];
+  return true;
+}
+
+// State shared by the tasks of one bound.
+struct SharedState {
+  std::atomic<bool> found = false;
+  std::atomic<bool> stopped = false;  // timeout or cancelled
+  std::mutex lock;
+  std::vector<int> solution;
+  Clock::time_point deadline;
+  const SolveHooks* hooks;
+};
+
+class SubtreeSearch {
+public:
+  explicit SubtreeSearch(SharedState& shared) : shared(shared) {}
+
+  void run(const Node& root, std::vector<int> moves, int togo) {
+    SolveStats* stats = shared.hooks->stats;
+    const Clock::time_point start = stats ? Clock::now() : Clock::time_point();
+    sofar = std::move(moves);
+    search(root, togo);
+    if (!stats) return;
+    stats->optimal_nodes.fetch_add(nodes, std::memory_order_relaxed);
+    stats->busy_ns.fetch_add(nanoseconds(Clock::now() - start), std::memory_order_relaxed);
+  }
+
+private:
+  // Returns true if the search has to stop.
+  bool search(const Node& n, int togo) {
+    if (++nodes % 4096 == 0 && (Clock::now() > shared.deadline || (shared.hooks->cancel && *shared.hooks->cancel)))
+      shared.stopped = true;
+    if (shared.found || shared.stopped) return true;
+    if (togo == 0) {
+      if (!n.solved()) return false;
+      std::lock_guard guard(shared.lock);
+      if (!shared.found) shared.solution = sofar;
+      shared.found = true;
+      return true;
+    }
+    Node c;
+    for (int m = 0; m < N_MOVE; m++) {
+      if (!sofar.empty() && redundant(sofar.back(), m)) continue;
+      if (!child(n, m, togo, c)) continue;  // the remaining togo - 1 moves are not enough
+      sofar.push_back(m);
+      bool stop = search(c, togo - 1);
+      sofar.pop_back();
+      if (stop) return true;
+    }
+    return false;
+  }
+
+  SharedState& shared;
+  std::vector<int> sofar;
+  uint64_t nodes = 0;
+};
+
+using Subtree = std::pair<Node, std::vector<int>>;  // the node and the moves leading to it
+
+// The nodes depth moves below n which may lie on a maneuver of bound moves, the roots of the search tasks.
+void split(const Node& n, std::vector<int>& moves, int depth, int bound, std::vector<Subtree>& out) {
+  if (depth == 0) {
+    out.emplace_back(n, moves);
+    return;
+  }
+  Node c;
+  for (int m = 0; m < N_MOVE; m++) {
+    if (!moves.empty() && redundant(moves.back(), m)) continue;
+    if (!child(n, m, bound - int(moves.size()), c)) continue;
+    moves.push_back(m);
+    split(c, moves, depth - 1, bound, out);
+    moves.pop_back();
+  }
+}
+
+std::string format(const std::vector<int>& man) {
+  std::string s;
+  for (int m : man) s += std::string(move_name[m]) + " ";
+  return s + "(" + std::to_string(man.size()) + "f)";
+}
+
+}  // namespace
+
+void init_optimal() {
+  static std::once_flag once;
+  std::call_once(once, [] {
+    init();
+    pr::init_optimal();
+  });
+}
+
+std::string solve_optimal(const std::string& cubestring, double timeout, const SolveHooks& hooks) {
+  FaceCube fc;
+  std::string s = fc.from_string(cubestring);
+  if (!s.empty()) return s;
+  CubieCube cc = fc.to_cubie_cube();
+  s = cc.verify();
+  if (!s.empty()) return s;
+
+  init_optimal();
+  Node root;
+  for (int rot = 0; rot < 3; rot++) {
+    CubieCube cb = cc;
+    if (rot == 1) {  // conjugation by 120° rotation
+      cb = symCube[32];
+      cb.multiply(cc);
+      cb.multiply(symCube[16]);
+    } else if (rot == 2) {  // conjugation by 240° rotation
+      cb = symCube[16];
+      cb.multiply(cc);
+      cb.multiply(symCube[32]);
+    }
+    CoordCube co(cb);
+    root.axis[rot] = {co.flip, co.twist, co.slice_sorted, co.corners, co.get_depth_phase1(),
+                      get_depth_flipslice_corners(co.flip, co.slice_sorted, co.corners)};
+    if (rot == 0) {
+      root.u_edges = co.u_edges;
+      root.d_edges = co.d_edges;
+    }
+  }
+
+  const Clock::time_point start_time = Clock::now();
+  SharedState shared;
+  if (hooks.deadline > 0) timeout = std::min(timeout, hooks.deadline);
+  shared.deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeout));
+  shared.hooks = &hooks;
+  ThreadPool& workers = hooks.pool ? *hooks.pool : search_pool();
+  int bound = root.bound();
+  for (; bound <= 20 && !shared.found && !shared.stopped; bound++) {
+    if (bound == 0) {
+      if (root.solved()) shared.found = true;
+      continue;
+    }
+    std::vector<Subtree> roots;
+    std::vector<int> moves;
+    split(root, moves, std::min(SPLIT_DEPTH, bound), bound, roots);
+    std::vector<ThreadPool::Task> tasks;
+    for (auto& [node, path] : roots) {
+      int togo = bound - int(path.size());
+      tasks.push_back([&shared, &node, &path, togo] { SubtreeSearch(shared).run(node, path, togo); });
+    }
+    workers.run(std::move(tasks));
+    // the tasks check every 4096 nodes, a round may end without any of them having seen the deadline
+    if (Clock::now() > shared.deadline || (hooks.cancel && *hooks.cancel)) shared.stopped = true;
+  }
+
+  if (SolveStats* stats = hooks.stats) {
+    uint64_t wall = nanoseconds(Clock::now() - start_time);
+    stats->wall_ns += wall;
+    stats->thread_ns += wall * uint64_t(workers.size() + 1);  // the caller helps with the tasks
+    std::lock_guard guard(stats->lock);
+    if (shared.found)
+      stats->improvements.emplace_back(std::chrono::duration<double>(Clock::now() - start_time).count(),
+                                       int(shared.solution.size()));
+  }
+  if (hooks.cancel && *hooks.cancel) return "Error: Search cancelled.";
+  if (!shared.found) {
+    char msg[100];
+    std::snprintf(msg, sizeof(msg), "Error: Timeout, the shortest maneuver has more than %d moves.", bound - 2);
+    return msg;
+  }
+  if (hooks.cache) hooks.cache->insert(cc, shared.solution);
+  std::string ret = format(shared.solution);
+  if (hooks.improved) hooks.improved(ret);
+  return ret;
+}
+
+}  // namespace twophase
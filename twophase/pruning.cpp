@@ -0,0 +1,405 @@
+#include "pruning.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+#include "moves.hpp"
+#include "symmetries.hpp"
+#include "thread_pool.hpp"
+
+namespace twophase::pr {
+
+Table<uint32_t> flipslice_twist_depth3;
+Table<uint32_t> corners_ud_edges_depth3;
+Table<int8_t> cornslice_depth;
+Table<uint32_t> flipslice_corners_depth3;
+
+namespace {
+
+// Only the phase 2 moves U1, U2, U3, R2, F2, D1, D2, D3, L2, B2.
+constexpr Move phase2_moves[10] = {U1, U2, U3, R2, F2, D1, D2, D3, L2, B2};
+
+// The tables are filled level by level with one BFS sweep per depth, each sweep is split into ranges of symmetry
+// classes which run in parallel. All cell accesses are atomic. An entry only changes once, from 3 (empty) to its
+// depth mod 3, and all threads of a sweep write the same value, so the result does not depend on the order in which
+// the threads fill the entries and the tables are identical to the ones of the single threaded kociemba/pruning.py.
+
+inline uint32_t get_depth3(uint32_t* table, uint32_t ix) {
+  return (std::atomic_ref(table[ix >> 4]).load(std::memory_order_relaxed) >> ((ix & 15) * 2)) & 3;
+}
+
+inline bool word_empty(uint32_t* table, uint32_t ix) {  // all 16 entries of the word of ix are empty
+  return std::atomic_ref(table[ix >> 4]).load(std::memory_order_relaxed) == 0xffffffff;
+}
+
+// Set the empty entry ix to value by clearing bits. Returns false if another thread has set it in the meantime.
+inline bool set_depth3(uint32_t* table, uint32_t ix, uint32_t value) {
+  uint32_t shift = (ix & 15) * 2;
+  uint32_t old = std::atomic_ref(table[ix >> 4]).fetch_and(~((3u ^ value) << shift), std::memory_order_relaxed);
+  return ((old >> shift) & 3) == 3;
+}
+
+// Set several entries of one word, mask has the bits to clear.
+inline void clear_bits(uint32_t* table, uint32_t word, uint32_t mask) {
+  if (mask) std::atomic_ref(table[word]).fetch_and(~mask, std::memory_order_relaxed);
+}
+
+// Run sweep(first, last) over the classes [0, n) in chunks on all hardware threads, returns the sum of the results.
+template <typename Sweep>
+uint32_t parallel_sweep(ThreadPool& workers, int n, Sweep sweep) {
+  const int chunks = std::min(n, 64 * workers.size());  // small enough chunks to balance the uneven classes
+  std::atomic<uint32_t> sum = 0;
+  std::vector<ThreadPool::Task> tasks;
+  for (int c = 0; c < chunks; c++) {
+    int first = int(int64_t(n) * c / chunks), last = int(int64_t(n) * (c + 1) / chunks);
+    tasks.push_back([&sweep, &sum, first, last] { sum += sweep(first, last); });
+  }
+  workers.run(std::move(tasks));
+  return sum;
+}
+
+// One BFS sweep of the phase 1 table over the flipslice classes [first, last) from depth to depth + 1. Returns the
+// number of entries filled.
+uint32_t phase1_sweep(uint32_t* table, const uint16_t* fs_sym, int depth, bool backsearch, int first, int last) {
+  // the atomic updates are compiler barriers, local copies of the table pointers stay in registers
+  const uint16_t* twist_move = mv::twist_move.data();
+  const uint16_t* flip_move = mv::flip_move.data();
+  const uint16_t* slice_sorted_move = mv::slice_sorted_move.data();
+  const uint16_t* flipslice_classidx = sy::flipslice_classidx.data();
+  const uint8_t* flipslice_sym = sy::flipslice_sym.data();
+  const uint16_t* twist_conj = sy::twist_conj.data();
+  const uint32_t* flipslice_rep = sy::flipslice_rep.data();
+  const uint32_t depth3 = depth % 3;
+  uint32_t filled = 0;
+  uint32_t idx = uint32_t(N_TWIST) * first;
+  uint32_t pending = 0;  // backwards search: bits to clear in the word of idx, written with one atomic and
+  for (int fs_classidx = first; fs_classidx < last; fs_classidx++) {
+    int twist = 0;
+    while (twist < N_TWIST) {
+      // ########## if table entries are not populated, this is very fast: #############################################
+      if (!backsearch && idx % 16 == 0 && word_empty(table, idx) && twist < N_TWIST - 16) {
+        twist += 16;
+        idx += 16;
+        continue;
+      }
+      bool match = backsearch ? get_depth3(table, idx) == 3 : get_depth3(table, idx) == depth3;
+      if (match) {
+        uint32_t flipslice = flipslice_rep[fs_classidx];
+        int flip = flipslice % 2048;  // N_FLIP = 2048
+        int slice_ = flipslice >> 11;  // / N_FLIP
+        for (int m = 0; m < N_MOVE; m++) {
+          int twist1 = twist_move[18 * twist + m];
+          int flip1 = flip_move[18 * flip + m];
+          int slice1 = slice_sorted_move[432 * slice_ + m] / 24;  // N_PERM_4 = 24, 18*24 = 432
+          int flipslice1 = (slice1 << 11) + flip1;
+          uint32_t fs1_classidx = flipslice_classidx[flipslice1];
+          int fs1_sym = flipslice_sym[flipslice1];
+          twist1 = twist_conj[(twist1 << 4) + fs1_sym];
+          uint32_t idx1 = 2187 * fs1_classidx + twist1;  // N_TWIST = 2187
+          if (!backsearch) {
+            if (get_depth3(table, idx1) == 3) {  // entry not yet filled
+              filled += set_depth3(table, idx1, (depth + 1) % 3);
+              // ####symmetric position has eventually more than one representation ####################################
+              uint32_t sym = fs_sym[fs1_classidx];
+              if (sym != 1) {
+                for (int k = 1; k < 16; k++) {
+                  sym >>= 1;
+                  if (sym % 2 == 1) {
+                    uint32_t twist2 = twist_conj[(twist1 << 4) + k];
+                    // fs2_classidx = fs1_classidx due to symmetry
+                    uint32_t idx2 = 2187 * fs1_classidx + twist2;
+                    if (get_depth3(table, idx2) == 3) filled += set_depth3(table, idx2, (depth + 1) % 3);
+                  }
+                }
+              }
+            }
+          } else if (get_depth3(table, idx1) == depth3) {  // backwards search
+            pending |= (3u ^ ((depth + 1) % 3)) << ((idx & 15) * 2);  // only this thread writes entry idx
+            filled++;
+            break;
+          }
+        }
+      }
+      twist++;
+      idx++;  // idx = N_TWIST * fs_class + twist
+      if (idx % 16 == 0) {
+        clear_bits(table, (idx - 1) >> 4, pending);
+        pending = 0;
+      }
+    }
+  }
+  clear_bits(table, (idx - 1) >> 4, pending);
+  return filled;
+}
+
+// One BFS sweep of the phase 2 table over the corner classes [first, last) from depth to depth + 1. Returns the number
+// of entries filled.
+uint32_t phase2_sweep(uint32_t* table, const uint16_t* c_sym, int depth, int first, int last) {
+  const uint16_t* ud_edges_move = mv::ud_edges_move.data();
+  const uint16_t* corners_move = mv::corners_move.data();
+  const uint16_t* corner_classidx = sy::corner_classidx.data();
+  const uint8_t* corner_sym = sy::corner_sym.data();
+  const uint16_t* ud_edges_conj = sy::ud_edges_conj.data();
+  const uint16_t* corner_rep = sy::corner_rep.data();
+  const uint32_t depth3 = depth % 3;
+  uint32_t filled = 0;
+  uint32_t idx = uint32_t(N_UD_EDGES) * first;
+  for (int c_classidx = first; c_classidx < last; c_classidx++) {
+    int ud_edge = 0;
+    while (ud_edge < N_UD_EDGES) {
+      // ################ if table entries are not populated, this is very fast: #######################################
+      if (idx % 16 == 0 && word_empty(table, idx) && ud_edge < N_UD_EDGES - 16) {
+        ud_edge += 16;
+        idx += 16;
+        continue;
+      }
+      if (get_depth3(table, idx) == depth3) {
+        int corner = corner_rep[c_classidx];
+        for (Move m : phase2_moves) {  // only iterate phase 2 moves
+          int ud_edge1 = ud_edges_move[18 * ud_edge + m];
+          int corner1 = corners_move[18 * corner + m];
+          uint32_t c1_classidx = corner_classidx[corner1];
+          int c1_sym = corner_sym[corner1];
+          ud_edge1 = ud_edges_conj[(ud_edge1 << 4) + c1_sym];
+          uint32_t idx1 = 40320 * c1_classidx + ud_edge1;  // N_UD_EDGES = 40320
+          if (get_depth3(table, idx1) == 3) {  // entry not yet filled
+            filled += set_depth3(table, idx1, (depth + 1) % 3);  // depth + 1 <= 10
+            // ######symmetric position has eventually more than one representation ####################################
+            uint32_t sym = c_sym[c1_classidx];
+            if (sym != 1) {
+              for (int k = 1; k < 16; k++) {
+                sym >>= 1;
+                if (sym % 2 == 1) {
+                  uint32_t ud_edge2 = ud_edges_conj[(ud_edge1 << 4) + k];
+                  // c1_classidx does not change
+                  uint32_t idx2 = 40320 * c1_classidx + ud_edge2;
+                  if (get_depth3(table, idx2) == 3) filled += set_depth3(table, idx2, (depth + 1) % 3);
+                }
+              }
+            }
+          }
+        }
+      }
+      ud_edge++;
+      idx++;  // idx = N_UD_EDGES * corner_classidx + ud_edge
+    }
+  }
+  return filled;
+}
+
+// One BFS sweep of the optimal solver table over the flipslice classes [first, last) from depth to depth + 1, like
+// phase1_sweep() with the corner permutation in place of the twist. Returns the number of entries filled.
+uint32_t optimal_sweep(uint32_t* table, const uint16_t* fs_sym, int depth, bool backsearch, int first, int last) {
+  const uint16_t* corners_move = mv::corners_move.data();
+  const uint16_t* flip_move = mv::flip_move.data();
+  const uint16_t* slice_sorted_move = mv::slice_sorted_move.data();
+  const uint16_t* flipslice_classidx = sy::flipslice_classidx.data();
+  const uint8_t* flipslice_sym = sy::flipslice_sym.data();
+  const uint16_t* corners_conj = sy::corners_conj.data();
+  const uint32_t* flipslice_rep = sy::flipslice_rep.data();
+  const uint32_t depth3 = depth % 3;
+  uint32_t filled = 0;
+  uint32_t idx = uint32_t(N_CORNERS) * first;
+  uint32_t pending = 0;  // backwards search: bits to clear in the word of idx
+  for (int fs_classidx = first; fs_classidx < last; fs_classidx++) {
+    uint32_t flipslice = flipslice_rep[fs_classidx];
+    int flip = flipslice % 2048;  // N_FLIP = 2048
+    int slice_ = flipslice >> 11;  // / N_FLIP
+    int corners = 0;
+    while (corners < N_CORNERS) {
+      if (!backsearch && idx % 16 == 0 && word_empty(table, idx) && corners < N_CORNERS - 16) {
+        corners += 16;
+        idx += 16;
+        continue;
+      }
+      bool match = backsearch ? get_depth3(table, idx) == 3 : get_depth3(table, idx) == depth3;
+      if (match) {
+        for (int m = 0; m < N_MOVE; m++) {
+          int corners1 = corners_move[18 * corners + m];
+          int flip1 = flip_move[18 * flip + m];
+          int slice1 = slice_sorted_move[432 * slice_ + m] / 24;  // N_PERM_4 = 24, 18*24 = 432
+          int flipslice1 = (slice1 << 11) + flip1;
+          uint32_t fs1_classidx = flipslice_classidx[flipslice1];
+          int fs1_sym = flipslice_sym[flipslice1];
+          corners1 = corners_conj[(corners1 << 4) + fs1_sym];
+          uint32_t idx1 = 40320 * fs1_classidx + corners1;  // N_CORNERS = 40320
+          if (!backsearch) {
+            if (get_depth3(table, idx1) == 3) {  // entry not yet filled
+              filled += set_depth3(table, idx1, (depth + 1) % 3);
+              uint32_t sym = fs_sym[fs1_classidx];  // the symmetric representations of the position
+              if (sym != 1) {
+                for (int k = 1; k < 16; k++) {
+                  sym >>= 1;
+                  if (sym % 2 == 1) {
+                    uint32_t idx2 = 40320 * fs1_classidx + corners_conj[(corners1 << 4) + k];
+                    if (get_depth3(table, idx2) == 3) filled += set_depth3(table, idx2, (depth + 1) % 3);
+                  }
+                }
+              }
+            }
+          } else if (get_depth3(table, idx1) == depth3) {  // backwards search
+            pending |= (3u ^ ((depth + 1) % 3)) << ((idx & 15) * 2);  // only this thread writes entry idx
+            filled++;
+            break;
+          }
+        }
+      }
+      corners++;
+      idx++;  // idx = N_CORNERS * fs_class + corners
+      if (idx % 16 == 0) {
+        clear_bits(table, (idx - 1) >> 4, pending);
+        pending = 0;
+      }
+    }
+  }
+  clear_bits(table, (idx - 1) >> 4, pending);
+  return filled;
+}
+
+// The symmetries of the flipslice classes, bit s is set if symmetry s maps the representant onto itself.
+std::vector<uint16_t> flipslice_self_symmetries() {
+  std::vector<uint16_t> fs_sym(N_FLIPSLICE_CLASS, 0);
+  CubieCube cc;
+  for (int i = 0; i < N_FLIPSLICE_CLASS; i++) {
+    uint32_t rep = sy::flipslice_rep[i];
+    cc.set_slice(int(rep / N_FLIP));
+    cc.set_flip(int(rep % N_FLIP));
+    for (int s = 0; s < N_SYM_D4h; s++) {
+      CubieCube ss = symCube[s];
+      ss.edge_multiply(cc);  // s*cc
+      ss.edge_multiply(symCube[inv_idx[s]]);  // s*cc*s^-1
+      if (uint32_t(ss.get_slice()) == rep / N_FLIP && uint32_t(ss.get_flip()) == rep % N_FLIP) fs_sym[i] |= 1 << s;
+    }
+  }
+  return fs_sym;
+}
+
+std::vector<uint32_t> create_phase1_prun_table() {
+  const uint32_t total = uint32_t(N_FLIPSLICE_CLASS) * N_TWIST;
+  std::vector<uint32_t> table(total / 16 + 1, 0xffffffff);
+  uint32_t* cells = table.data();
+
+  // #################### create table with the symmetries of the flipslice classes ####################################
+  std::vector<uint16_t> fs_sym = flipslice_self_symmetries();
+
+  set_depth3(cells, 0, 0);  // fs_classidx = 0 and twist = 0 for solved phase 1
+  uint32_t done = 1;
+  int depth = 0;
+  bool backsearch = false;
+  ThreadPool workers;
+  while (done != total) {
+    if (depth == 9) backsearch = true;  // backwards search is faster for depth >= 9
+    done += parallel_sweep(workers, N_FLIPSLICE_CLASS, [&](int first, int last) {
+      return phase1_sweep(cells, fs_sym.data(), depth, backsearch, first, last);
+    });
+    depth++;
+    std::cerr << "depth: " << depth << " done: " << done << "/" << total << std::endl;
+  }
+  return table;
+}
+
+std::vector<uint32_t> create_phase2_prun_table() {
+  const uint32_t total = uint32_t(N_CORNERS_CLASS) * N_UD_EDGES;
+  std::vector<uint32_t> table(total / 16, 0xffffffff);
+  uint32_t* cells = table.data();
+
+  // ##################### create table with the symmetries of the corners classes #####################################
+  std::vector<uint16_t> c_sym(N_CORNERS_CLASS, 0);
+  CubieCube cc;
+  for (int i = 0; i < N_CORNERS_CLASS; i++) {
+    int rep = sy::corner_rep[i];
+    cc.set_corners(rep);
+    for (int s = 0; s < N_SYM_D4h; s++) {
+      CubieCube ss = symCube[s];
+      ss.corner_multiply(cc);  // s*cc
+      ss.corner_multiply(symCube[inv_idx[s]]);  // s*cc*s^-1
+      if (ss.get_corners() == rep) c_sym[i] |= 1 << s;
+    }
+  }
+
+  set_depth3(cells, 0, 0);  // c_classidx = 0 and ud_edge = 0 for solved phase 2
+  uint32_t done = 1;
+  int depth = 0;
+  ThreadPool workers;
+  while (depth < 10) {  // we fill the table only do depth 9 + 1
+    done += parallel_sweep(workers, N_CORNERS_CLASS, [&](int first, int last) {
+      return phase2_sweep(cells, c_sym.data(), depth, first, last);
+    });
+    depth++;
+    std::cerr << "depth: " << depth << " done: " << done << "/" << total << std::endl;
+  }
+  // remaining unfilled entries have depth >= 11
+  return table;
+}
+
+// Distance to the subgroup with solved flip, slice and corner permutation for the optimal solver. The table is 18
+// times larger than the phase 1 table, so instead of a fixed depth the backwards search starts when the last sweep has
+// filled a sixth of the remaining entries and the next level is likely to be the largest.
+std::vector<uint32_t> create_optimal_prun_table() {
+  const uint32_t total = uint32_t(N_FLIPSLICE_CLASS) * N_CORNERS;
+  std::vector<uint32_t> table(total / 16, 0xffffffff);
+  uint32_t* cells = table.data();
+  std::vector<uint16_t> fs_sym = flipslice_self_symmetries();
+
+  set_depth3(cells, 0, 0);  // fs_classidx = 0 and corners = 0 for the solved cube
+  uint32_t done = 1;
+  int depth = 0;
+  bool backsearch = false;
+  ThreadPool workers;
+  while (done != total) {
+    uint32_t filled = parallel_sweep(workers, N_FLIPSLICE_CLASS, [&](int first, int last) {
+      return optimal_sweep(cells, fs_sym.data(), depth, backsearch, first, last);
+    });
+    done += filled;
+    depth++;
+    if (uint64_t(filled) * 6 > total - done) backsearch = true;
+    std::cerr << "depth: " << depth << " done: " << done << "/" << total << std::endl;
+  }
+  return table;
+}
+
+// With this table we do a fast precheck at the beginning of phase 2.
+std::vector<int8_t> create_phase2_cornsliceprun_table() {
+  std::vector<int8_t> table(N_CORNERS * N_PERM_4, -1);
+  table[0] = 0;  // values for solved phase 2
+  int done = 1;
+  int depth = 0;
+  while (done != N_CORNERS * N_PERM_4) {
+    for (int corners = 0; corners < N_CORNERS; corners++) {
+      for (int slice_ = 0; slice_ < N_PERM_4; slice_++) {
+        if (table[N_PERM_4 * corners + slice_] != depth) continue;
+        for (Move m : phase2_moves) {
+          int corners1 = mv::corners_move[18 * corners + m];
+          int slice_1 = mv::slice_sorted_move[18 * slice_ + m];
+          int idx1 = N_PERM_4 * corners1 + slice_1;
+          if (table[idx1] == -1) {  // entry not yet filled
+            table[idx1] = int8_t(depth + 1);
+            done++;
+          }
+        }
+      }
+    }
+    depth++;
+  }
+  return table;
+}
+
+}  // namespace
+
+void init() {
+  const size_t total1 = size_t(N_FLIPSLICE_CLASS) * N_TWIST;
+  const size_t total2 = size_t(N_CORNERS_CLASS) * N_UD_EDGES;
+  flipslice_twist_depth3 = load_or_create<uint32_t>("phase1_prun", total1 / 16 + 1, create_phase1_prun_table);
+  corners_ud_edges_depth3 = load_or_create<uint32_t>("phase2_prun", total2 / 16, create_phase2_prun_table);
+  cornslice_depth =
+      load_or_create<int8_t>("phase2_cornsliceprun", N_CORNERS * N_PERM_4, create_phase2_cornsliceprun_table);
+}
+
+void init_optimal() {
+  const size_t total = size_t(N_FLIPSLICE_CLASS) * N_CORNERS;
+  flipslice_corners_depth3 = load_or_create<uint32_t>("optimal_prun", total / 16, create_optimal_prun_table);
+}
+
+}  // namespace twophase::pr
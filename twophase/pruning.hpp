@@ -0,0 +1,57 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+#include "tables.hpp"
+
+// ##################### The pruning tables cut the search tree during the search. ######################################
+// ##################### The pruning values are stored modulo 3 which saves a lot of memory. ############################
+// Mirrors kociemba/pruning.py, 16 entries of 2 bits are packed into one uint32.
+
+namespace twophase::pr {
+
+extern Table<uint32_t> flipslice_twist_depth3;
+extern Table<uint32_t> corners_ud_edges_depth3;
+extern Table<int8_t> cornslice_depth;
+// Only used by the optimal solver and loaded by init_optimal(): 2 bits per flipslice class and corner permutation,
+// about 650 MB.
+extern Table<uint32_t> flipslice_corners_depth3;
+
+// get_flipslice_twist_depth3(ix) is *exactly* the number of moves % 3 to solve phase 1 of a cube with index ix
+inline uint32_t get_flipslice_twist_depth3(uint32_t ix) {
+  return (flipslice_twist_depth3[ix >> 4] >> ((ix & 15) * 2)) & 3;
+}
+
+// get_corners_ud_edges_depth3(ix) is *at least* the number of moves % 3 to solve phase 2 of a cube with index ix
+inline uint32_t get_corners_ud_edges_depth3(uint32_t ix) {
+  return (corners_ud_edges_depth3[ix >> 4] >> ((ix & 15) * 2)) & 3;
+}
+
+// get_flipslice_corners_depth3(ix) is *exactly* the number of moves % 3 to solve flip, slice and the corner permutation
+// of a cube with index ix
+inline uint32_t get_flipslice_corners_depth3(uint32_t ix) {
+  return (flipslice_corners_depth3[ix >> 4] >> ((ix & 15) * 2)) & 3;
+}
+
+// distance computes the new distance from the old_distance i and the new_distance_mod3 j as distance[3 * i + j].
+// We need this array because the pruning tables only store the distances mod 3.
+inline constexpr std::array<int8_t, 60> distance = [] {
+  std::array<int8_t, 60> ret{};
+  for (int i = 0; i < 20; i++) {
+    for (int j = 0; j < 3; j++) {
+      ret[3 * i + j] = int8_t((i / 3) * 3 + j);
+      if (i % 3 == 2 && j == 0)
+        ret[3 * i + j] += 3;
+      else if (i % 3 == 0 && j == 2)
+        ret[3 * i + j] -= 3;
+    }
+  }
+  return ret;
+}();
+
+// Load the pruning tables from FOLDER or create them. Needs the move and symmetry tables.
+void init();
+// Load flipslice_corners_depth3 from FOLDER or create it, which takes long. Needs the move and symmetry tables.
+void init_optimal();
+
+}  // namespace twophase::pr
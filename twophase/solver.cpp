@@ -0,0 +1,472 @@
+#include "solver.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "cache.hpp"
+#include "coord.hpp"
+#include "face.hpp"
+#include "moves.hpp"
+#include "pruning.hpp"
+#include "symmetries.hpp"
+#include "thread_pool.hpp"
+
+namespace twophase {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+inline uint64_t nanoseconds(Clock::duration d) {
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+}
+
+// The phase 1 search tree is split into subtrees until there are this many tasks per pool thread.
+constexpr int TASKS_PER_THREAD = 16;
+// Nodes between two checks of the deadline by a search task.
+constexpr uint64_t DEADLINE_CHECK_NODES = 4096;
+
+// One rotated and/or inverted version of the cube which is searched.
+struct Direction {
+  int rot;  // the cube is rotated 120° * rot along the long diagonal before applying the two-phase-algorithm
+  int inv;  // 1: the cube is inverted before applying the two-phase-algorithm
+  CoordCube co_cube;  // the rotated/inverted cube in coordinate representation
+  int dist;  // distance to subgroup H, the phase 1 maneuver has at least dist moves
+};
+
+// State shared by all search tasks of one solve() call.
+struct SharedState {
+  std::mutex lock;  // guards solutions
+  std::vector<std::vector<int>> solutions;  // the last solution is the shortest
+  std::atomic<int> shortest_length = 999;  // every task prunes against the global best
+  std::atomic<bool> terminated = false;
+  int ret_length;  // if a solution with length <= ret_length is found the search stops
+  double timeout;
+  Clock::time_point start_time;
+  Clock::time_point deadline = Clock::time_point::max();  // hooks->deadline, the search stops even without a solution
+  std::atomic<bool> expired = false;  // the deadline has passed
+  const SolveHooks* hooks;
+};
+
+// Root of a phase 1 subtree: the moves leading to it and the phase 1 coordinates after them.
+struct Subtree {
+  std::vector<int> moves;
+  int flip, twist, slice_sorted, dist;
+};
+
+// The maneuver in the format of solve(), "U1 R2 ... (Nf)".
+std::string format(const std::vector<int>& man) {
+  std::string s;
+  for (int m : man) s += std::string(move_name[m]) + " ";
+  return s + "(" + std::to_string(man.size()) + "f)";
+}
+
+// Successive moves on the same face or on the same axis in the wrong order are redundant.
+inline bool redundant(int last, int m) {
+  int diff = last / 3 - m / 3;
+  return diff == 0 || diff == 3;
+}
+
+inline bool is_phase2_move(int m) {
+  return m == U1 || m == U2 || m == U3 || m == R2 || m == F2 || m == D1 || m == D2 || m == D3 || m == L2 || m == B2;
+}
+
+// Phase 1 coordinates after move m, or false if subgroup H cannot be reached in togo_phase1 - 1 moves. Counts the
+// pruning table lookups in probes.
+inline bool phase1_child(int flip, int twist, int slice_sorted, int dist, int togo_phase1, int m, Subtree& child,
+                         uint64_t& probes) {
+  // dist = 0 means that we are already are in the subgroup H. If there are less than 5 moves left
+  // this forces all remaining moves to be phase 2 moves. So we can forbid these at the end of phase 1
+  // and generate these moves in phase 2.
+  if (dist == 0 && togo_phase1 < 5 && is_phase2_move(m)) return false;
+
+  child.flip = mv::flip_move[18 * flip + m];  // N_MOVE = 18
+  child.twist = mv::twist_move[18 * twist + m];
+  child.slice_sorted = mv::slice_sorted_move[18 * slice_sorted + m];
+
+  int flipslice = 2048 * (child.slice_sorted / 24) + child.flip;  // N_FLIP * (slice_sorted / N_PERM_4) + flip
+  int classidx = sy::flipslice_classidx[flipslice];
+  int sym = sy::flipslice_sym[flipslice];
+  int dist_new_mod3 = int(pr::get_flipslice_twist_depth3(2187 * classidx + sy::twist_conj[(child.twist << 4) + sym]));
+  probes++;
+  child.dist = pr::distance[3 * dist + dist_new_mod3];
+  return child.dist < togo_phase1;  // else impossible to reach subgroup H in togo_phase1 - 1 moves
+}
+
+// Depth-first search of one phase 1 subtree, implements the two phase algorithm of kociemba/solver.py.
+class SubtreeSearch {
+public:
+  SubtreeSearch(const Direction& dir, SharedState& shared) : dir(dir), shared(shared) {}
+
+  void run(const Subtree& root, int togo_phase1) {
+    SolveStats* stats = shared.hooks->stats;
+    const Clock::time_point start = stats ? Clock::now() : Clock::time_point();
+    sofar_phase1 = root.moves;
+    search(root.flip, root.twist, root.slice_sorted, root.dist, togo_phase1);
+    if (!stats) return;
+    uint64_t phase1_nodes = 0, phase2_nodes = 0;
+    for (int d = 0; d < SolveStats::MAX_DEPTH; d++) {
+      phase1_nodes += phase1_by_depth[d];
+      phase2_nodes += phase2_by_depth[d];
+      if (phase1_by_depth[d]) stats->phase1_nodes_by_depth[d].fetch_add(phase1_by_depth[d], std::memory_order_relaxed);
+      if (phase2_by_depth[d]) stats->phase2_nodes_by_depth[d].fetch_add(phase2_by_depth[d], std::memory_order_relaxed);
+    }
+    stats->phase1_nodes.fetch_add(phase1_nodes, std::memory_order_relaxed);
+    stats->phase2_nodes.fetch_add(phase2_nodes, std::memory_order_relaxed);
+    stats->prune_probes.fetch_add(probes, std::memory_order_relaxed);
+    stats->phase2_entries.fetch_add(phase2_entries, std::memory_order_relaxed);
+    stats->lock_wait_ns.fetch_add(lock_wait_ns, std::memory_order_relaxed);
+    stats->busy_ns.fetch_add(nanoseconds(Clock::now() - start), std::memory_order_relaxed);
+  }
+
+private:
+  void search_phase2(int corners, int ud_edges, int slice_sorted, int dist, int togo_phase2);
+  void search(int flip, int twist, int slice_sorted, int dist, int togo_phase1);
+  void store_solution();
+  // Called at every node, stops the search when the deadline has passed.
+  inline void check_deadline() {
+    if (++nodes % DEADLINE_CHECK_NODES == 0 && Clock::now() > shared.deadline) {
+      shared.expired = true;
+      shared.terminated = true;
+    }
+  }
+
+  const Direction& dir;
+  SharedState& shared;
+  std::vector<int> sofar_phase1, sofar_phase2;
+  bool phase2_done = false;
+  int cornersave = 0;
+  bool cornersave_valid = false;  // cornersave belongs to the previous phase 1 solution of this subtree
+  // statistics of this task, see SolveStats
+  std::array<uint64_t, SolveStats::MAX_DEPTH> phase1_by_depth{}, phase2_by_depth{};
+  uint64_t probes = 0, phase2_entries = 0, lock_wait_ns = 0;
+  uint64_t nodes = 0;  // for check_deadline()
+};
+
+void SubtreeSearch::store_solution() {
+  std::vector<int> man = sofar_phase1;
+  man.insert(man.end(), sofar_phase2.begin(), sofar_phase2.end());
+  SolveStats* stats = shared.hooks->stats;
+  const Clock::time_point wait = stats ? Clock::now() : Clock::time_point();
+  std::lock_guard guard(shared.lock);
+  if (stats) lock_wait_ns += nanoseconds(Clock::now() - wait);
+  if (shared.solutions.empty() || shared.solutions.back().size() > man.size()) {
+    if (dir.inv == 1) {  // we solved the inverse cube
+      std::reverse(man.begin(), man.end());
+      for (int& m : man) m = (m / 3) * 3 + (2 - m % 3);  // R1->R3, R2->R2, R3->R1 etc.
+    }
+    for (int& m : man) m = sy::conj_move[N_MOVE * 16 * dir.rot + m];
+    shared.shortest_length = int(man.size());
+    if (stats) {
+      std::lock_guard stats_guard(stats->lock);
+      stats->improvements.emplace_back(std::chrono::duration<double>(Clock::now() - shared.start_time).count(),
+                                       int(man.size()));
+    }
+    if (shared.hooks->improved) shared.hooks->improved(format(man));
+    shared.solutions.push_back(std::move(man));
+  }
+  if (shared.shortest_length <= shared.ret_length) shared.terminated = true;  // we have reached the target length
+}
+
+void SubtreeSearch::search_phase2(int corners, int ud_edges, int slice_sorted, int dist, int togo_phase2) {
+  if (shared.terminated.load(std::memory_order_relaxed) || phase2_done) return;
+  check_deadline();
+  phase2_by_depth[sofar_phase2.size()]++;
+  if (togo_phase2 == 0 && slice_sorted == 0) {  // phase 2 solved, store solution
+    store_solution();
+    phase2_done = true;
+    return;
+  }
+  for (int m = 0; m < N_MOVE; m++) {
+    if (m == R1 || m == R3 || m == F1 || m == F3 || m == L1 || m == L3 || m == B1 || m == B3) continue;
+    if (!sofar_phase2.empty()) {
+      if (redundant(sofar_phase2.back(), m)) continue;
+    } else if (!sofar_phase1.empty()) {
+      if (redundant(sofar_phase1.back(), m)) continue;
+    }
+    int corners_new = mv::corners_move[18 * corners + m];
+    int ud_edges_new = mv::ud_edges_move[18 * ud_edges + m];
+    int slice_sorted_new = mv::slice_sorted_move[18 * slice_sorted + m];
+
+    int classidx = sy::corner_classidx[corners_new];
+    int sym = sy::corner_sym[corners_new];
+    int dist_new_mod3 =
+        int(pr::get_corners_ud_edges_depth3(40320 * classidx + sy::ud_edges_conj[(ud_edges_new << 4) + sym]));
+    int dist_new = pr::distance[3 * dist + dist_new_mod3];
+    probes += 2;
+    if (std::max<int>(dist_new, pr::cornslice_depth[24 * corners_new + slice_sorted_new]) >= togo_phase2)
+      continue;  // impossible to reach solved cube in togo_phase2 - 1 moves
+
+    sofar_phase2.push_back(m);
+    search_phase2(corners_new, ud_edges_new, slice_sorted_new, dist_new, togo_phase2 - 1);
+    sofar_phase2.pop_back();
+  }
+}
+
+void SubtreeSearch::search(int flip, int twist, int slice_sorted, int dist, int togo_phase1) {
+  if (shared.terminated.load(std::memory_order_relaxed)) return;
+  check_deadline();
+  phase1_by_depth[sofar_phase1.size()]++;
+  if (togo_phase1 == 0) {  // phase 1 solved
+    if (shared.hooks->cancel && shared.hooks->cancel->load(std::memory_order_relaxed)) {
+      shared.terminated = true;
+      return;
+    }
+    if (Clock::now() > shared.start_time + std::chrono::duration<double>(shared.timeout) &&
+        shared.shortest_length.load() < 999)
+      shared.terminated = true;
+
+    // compute initial phase 2 coordinates
+    int m = sofar_phase1.empty() ? U1 : sofar_phase1.back();  // value is irrelevant if there are no phase 1 moves
+    int corners;
+    if ((m == R3 || m == F3 || m == L3 || m == B3) && cornersave_valid) {  // phase 1 solution come in pairs
+      corners = mv::corners_move[18 * cornersave + m - 1];  // apply R2, F2, L2 ord B2 on last ph1 solution
+    } else {
+      corners = dir.co_cube.corners;
+      for (int m1 : sofar_phase1) corners = mv::corners_move[18 * corners + m1];  // get current corner configuration
+      cornersave = corners;
+      cornersave_valid = true;
+    }
+
+    // new solution must be shorter and we do not use phase 2 maneuvers with length > 11 - 1 = 10
+    int togo2_limit = std::min(shared.shortest_length.load(std::memory_order_relaxed) - int(sofar_phase1.size()), 11);
+    probes++;
+    if (pr::cornslice_depth[24 * corners + slice_sorted] >= togo2_limit) return;  // precheck speeds up the computation
+    phase2_entries++;
+
+    int u_edges = dir.co_cube.u_edges;
+    int d_edges = dir.co_cube.d_edges;
+    for (int m1 : sofar_phase1) {
+      u_edges = mv::u_edges_move[18 * u_edges + m1];
+      d_edges = mv::d_edges_move[18 * d_edges + m1];
+    }
+    int ud_edges = coord::u_edges_plus_d_edges_to_ud_edges[24 * u_edges + d_edges % 24];
+
+    int dist2 = CoordCube::get_depth_phase2(corners, ud_edges);
+    probes++;
+    for (int togo2 = dist2; togo2 < togo2_limit; togo2++) {  // do not use more than togo2_limit - 1 moves in phase 2
+      sofar_phase2.clear();
+      phase2_done = false;
+      search_phase2(corners, ud_edges, slice_sorted, dist2, togo2);
+      if (phase2_done) break;  // solution already found
+    }
+    return;
+  }
+  Subtree child;
+  for (int m = 0; m < N_MOVE; m++) {
+    if (!sofar_phase1.empty() && redundant(sofar_phase1.back(), m)) continue;
+    if (!phase1_child(flip, twist, slice_sorted, dist, togo_phase1, m, child, probes)) continue;
+    sofar_phase1.push_back(m);
+    search(child.flip, child.twist, child.slice_sorted, child.dist, togo_phase1 - 1);
+    sofar_phase1.pop_back();
+  }
+}
+
+// Split the phase 1 search tree of depth togo1 into at least min_count subtrees, in depth-first order.
+std::vector<Subtree> split(const Direction& dir, int togo1, size_t min_count, uint64_t& probes) {
+  const CoordCube& cc = dir.co_cube;
+  std::vector<Subtree> level = {{{}, cc.flip, cc.twist, cc.slice_sorted, dir.dist}};
+  for (int depth = 0; depth < togo1 && level.size() < min_count; depth++) {
+    std::vector<Subtree> next;
+    Subtree child;
+    for (const Subtree& t : level) {
+      for (int m = 0; m < N_MOVE; m++) {
+        if (!t.moves.empty() && redundant(t.moves.back(), m)) continue;
+        if (!phase1_child(t.flip, t.twist, t.slice_sorted, t.dist, togo1 - depth, m, child, probes)) continue;
+        child.moves = t.moves;
+        child.moves.push_back(m);
+        next.push_back(child);
+      }
+    }
+    level = std::move(next);
+  }
+  return level;
+}
+
+std::mutex pool_lock;
+std::unique_ptr<ThreadPool> solver_pool;
+
+// The cube of a cube definition string, or the error message of the string.
+std::string to_cubie(const std::string& cubestring, CubieCube& cc) {
+  FaceCube fc;
+  std::string s = fc.from_string(cubestring);
+  if (!s.empty()) return s;  // no valid cubestring, gives invalid facelet cube
+  cc = fc.to_cubie_cube();
+  return cc.verify();  // no valid facelet cube, gives invalid cubie cube
+}
+
+// solve() of a valid cube.
+std::string solve_cubie(const CubieCube& cc, int max_length, double timeout, const SolveHooks& hooks) {
+  const Clock::time_point start_time = Clock::now();
+  if (std::vector<int> man; hooks.cache && hooks.cache->lookup(cc, max_length, man)) {
+    if (hooks.stats) {
+      std::lock_guard guard(hooks.stats->lock);
+      hooks.stats->improvements.emplace_back(std::chrono::duration<double>(Clock::now() - start_time).count(),
+                                             int(man.size()));
+      hooks.stats->wall_ns += nanoseconds(Clock::now() - start_time);
+    }
+    if (hooks.improved) hooks.improved(format(man));
+    return format(man);
+  }
+
+  init();
+  SharedState shared;
+  shared.ret_length = max_length;
+  shared.timeout = timeout;
+  shared.start_time = start_time;
+  if (hooks.deadline > 0)
+    shared.deadline =
+        start_time + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(hooks.deadline));
+  shared.hooks = &hooks;
+
+  std::vector<int> syms = cc.symmetries();
+  std::vector<int> tr = {0, 1, 2, 3, 4, 5};  // This means search in 3 directions + inverse cube
+  if (std::any_of(syms.begin(), syms.end(), [](int j) { return j == 16 || j == 20 || j == 24 || j == 28; }))
+    tr = {0, 3};  // we have some rotational symmetry along a long diagonal, so we search only one direction
+  if (std::any_of(syms.begin(), syms.end(), [](int j) { return j >= N_SYM; }))
+    std::erase_if(tr, [](int x) { return x >= 3; });  // we have some antisymmetry so we do not search the inverses
+
+  std::vector<Direction> dirs;
+  for (int i : tr) {
+    Direction d{i % 3, i / 3, {}, 0};
+    CubieCube cb = cc;
+    if (d.rot == 1) {  // conjugation by 120° rotation
+      cb = symCube[32];
+      cb.multiply(cc);
+      cb.multiply(symCube[16]);
+    } else if (d.rot == 2) {  // conjugation by 240° rotation
+      cb = symCube[16];
+      cb.multiply(cc);
+      cb.multiply(symCube[32]);
+    }
+    if (d.inv == 1) {  // invert cube
+      CubieCube tmp;
+      cb.inv_cubie_cube(tmp);
+      cb = tmp;
+    }
+    d.co_cube = CoordCube(cb);
+    d.dist = d.co_cube.get_depth_phase1();
+    dirs.push_back(d);
+  }
+
+  // Iterative deepening over the phase 1 length, all directions together. The subtrees of one depth are spread over
+  // the work-stealing pool, a solution has at least togo1 moves so deeper rounds cannot improve on shortest_length.
+  ThreadPool& workers = hooks.pool ? *hooks.pool : search_pool();
+  const size_t min_tasks = size_t(TASKS_PER_THREAD) * workers.size();
+  uint64_t split_probes = 0;
+  for (int togo1 = 0; togo1 < 20; togo1++) {
+    if (shared.terminated || togo1 >= shared.shortest_length || (hooks.cancel && *hooks.cancel)) break;
+    if (Clock::now() > shared.deadline) {  // the tasks of the last round may not have reached a deadline check
+      shared.expired = true;
+      break;
+    }
+    std::vector<ThreadPool::Task> tasks;
+    for (const Direction& d : dirs) {
+      if (d.dist > togo1) continue;
+      for (Subtree& t : split(d, togo1, (min_tasks + dirs.size() - 1) / dirs.size(), split_probes)) {
+        int togo = togo1 - int(t.moves.size());
+        tasks.push_back([&d, &shared, t = std::move(t), togo] { SubtreeSearch(d, shared).run(t, togo); });
+      }
+    }
+    workers.run(std::move(tasks));
+  }
+
+  if (SolveStats* stats = hooks.stats) {
+    uint64_t wall = nanoseconds(Clock::now() - start_time);
+    stats->prune_probes += split_probes;
+    stats->wall_ns += wall;
+    stats->thread_ns += wall * uint64_t(workers.size() + 1);  // the caller helps with the tasks
+  }
+  std::lock_guard guard(shared.lock);
+  if (hooks.cancel && *hooks.cancel) return "Error: Search cancelled.";
+  if (shared.solutions.empty() && (shared.expired || Clock::now() > shared.deadline)) return NO_SOLUTION_YET;
+  if (hooks.cache && !shared.solutions.empty()) hooks.cache->insert(cc, shared.solutions.back());
+  return format(shared.solutions.empty() ? std::vector<int>() : shared.solutions.back());  // the last is the shortest
+}
+
+}  // namespace
+
+ThreadPool& search_pool() {
+  std::lock_guard guard(pool_lock);
+  if (!solver_pool) solver_pool = std::make_unique<ThreadPool>();
+  return *solver_pool;
+}
+
+void init() {
+  static std::once_flag once;
+  std::call_once(once, [] {
+    mv::init();
+    sy::init();
+    pr::init();
+    coord::init();
+  });
+}
+
+void set_threads(int threads) {
+  std::lock_guard guard(pool_lock);
+  solver_pool = std::make_unique<ThreadPool>(threads);
+}
+
+std::string solve(const std::string& cubestring, int max_length, double timeout) {
+  return solve(cubestring, max_length, timeout, SolveHooks());
+}
+
+std::string solve(const std::string& cubestring, int max_length, double timeout, const SolveHooks& hooks) {
+  CubieCube cc;
+  std::string s = to_cubie(cubestring, cc);
+  if (!s.empty()) return s;
+  return solve_cubie(cc, max_length, timeout, hooks);
+}
+
+std::string solveto(const std::string& cubestring, const std::string& goalstring, int max_length, double timeout,
+                    const SolveHooks& hooks) {
+  std::string ret;
+  solveto_batch({cubestring}, {goalstring}, {{0, 0}}, max_length, timeout,
+                [&ret](size_t, const std::string& result) { ret = result; }, hooks);
+  return ret;
+}
+
+void solveto_batch(const std::vector<std::string>& cubes, const std::vector<std::string>& goals,
+                   const std::vector<SolvetoPair>& pairs, int max_length, double timeout,
+                   const std::function<void(size_t, const std::string&)>& result, const SolveHooks& hooks) {
+  // The checked starts and the inverted goals, converted when a pair needs them for the first time.
+  std::vector<CubieCube> start_cc(cubes.size()), goal_inv(goals.size());
+  std::vector<std::string> start_error(cubes.size()), goal_error(goals.size());
+  std::vector<bool> start_done(cubes.size()), goal_done(goals.size());
+  for (size_t i = 0; i < pairs.size(); i++) {
+    const auto [start, goal] = pairs[i];
+    if (start < 0 || size_t(start) >= cubes.size() || goal < 0 || size_t(goal) >= goals.size()) {
+      result(i, "Error: Invalid pair.");
+      continue;
+    }
+    if (!start_done[start]) {
+      start_error[start] = to_cubie(cubes[start], start_cc[start]);
+      start_done[start] = true;
+    }
+    if (!goal_done[goal]) {
+      CubieCube ccg;
+      goal_error[goal] = to_cubie(goals[goal], ccg);
+      if (goal_error[goal].empty()) ccg.inv_cubie_cube(goal_inv[goal]);
+      goal_done[goal] = true;
+    }
+    if (!start_error[start].empty()) {
+      result(i, "first cube " + start_error[start]);
+      continue;
+    }
+    if (!goal_error[goal].empty()) {
+      result(i, "second cube " + goal_error[goal]);
+      continue;
+    }
+    // cc0 * S = ccg  <=> (ccg^-1 * cc0) * S = Id
+    CubieCube cc = goal_inv[goal];
+    cc.multiply(start_cc[start]);
+    result(i, solve_cubie(cc, max_length, timeout, hooks));
+  }
+}
+
+}  // namespace twophase
@@ -0,0 +1,102 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ################### The two-phase algorithm, mirrors kociemba/solver.py ##############################################
+
+namespace twophase {
+
+class SolutionCache;
+class ThreadPool;
+
+// Load or create all move, symmetry and pruning tables. Called by solve(), may be called earlier to avoid the delay.
+void init();
+
+// Use a pool of threads for the search, the default is one thread per hardware thread. Must not be called while a
+// solve() is running.
+void set_threads(int threads);
+
+// Solve a cube defined by its cube definition string, see Fc in enums.hpp for the format.
+// The function returns if a maneuver of length <= max_length has been found. If the function times out after timeout
+// seconds, the best solution found so far is returned. If there has not been found any solution yet the computation
+// continues until a first solution appears.
+// The result has the format "U1 R2 ... (Nf)" like kociemba/solver.py, or an error message starting with "Error".
+std::string solve(const std::string& cubestring, int max_length = 20, double timeout = 3);
+
+// Search effort of solve() calls, summed over all search threads. The counters are kept by every search task and
+// added when it ends, so they cost next to nothing. One SolveStats may collect several solves.
+struct SolveStats {
+  static constexpr int MAX_DEPTH = 21;
+
+  std::atomic<uint64_t> phase1_nodes = 0;  // phase 1 nodes expanded, including the phase 1 leaves
+  std::atomic<uint64_t> phase2_nodes = 0;
+  std::atomic<uint64_t> optimal_nodes = 0;  // nodes of solve_optimal()
+  std::array<std::atomic<uint64_t>, MAX_DEPTH> phase1_nodes_by_depth{};  // by the number of phase 1 moves so far
+  std::array<std::atomic<uint64_t>, MAX_DEPTH> phase2_nodes_by_depth{};  // by the number of phase 2 moves so far
+  std::atomic<uint64_t> prune_probes = 0;  // pruning table lookups, a get_depth_phase2() counts once
+  std::atomic<uint64_t> phase2_entries = 0;  // phase 1 solutions which passed the precheck and were searched on
+  std::atomic<uint64_t> busy_ns = 0;  // run time of the search tasks, summed over the threads
+  std::atomic<uint64_t> lock_wait_ns = 0;  // waiting for the lock of the solutions found
+  std::atomic<uint64_t> wall_ns = 0;  // from the start to the end of the solves
+  std::atomic<uint64_t> thread_ns = 0;  // wall time times the pool threads, busy_ns / thread_ns is the utilization
+
+  std::mutex lock;  // guards improvements
+  // Seconds since the start of the solve and length of every shorter solution, the first is the time to the first
+  // solution.
+  std::vector<std::pair<double, int>> improvements;
+};
+
+// Result of a solve whose deadline has passed before it found any solution.
+inline constexpr const char* NO_SOLUTION_YET = "Error: No solution yet, the deadline has passed.";
+
+// Optional hooks of a running search.
+struct SolveHooks {
+  const std::atomic<bool>* cancel = nullptr;  // the search stops soon after *cancel has been set
+  SolveStats* stats = nullptr;  // the counters are added when a search task ends
+  std::function<void(const std::string&)> improved;  // called from a search thread with every shorter solution
+  SolutionCache* cache = nullptr;  // answers the solve if it knows a short enough solution, else gets the result
+  ThreadPool* pool = nullptr;  // runs the search tasks instead of search_pool(), e.g. a pool with a lower priority
+  // Hard limit in seconds from the start of the solve, 0: none. Unlike timeout it also stops a search without any
+  // solution, which then returns NO_SOLUTION_YET. Together with improved this makes solve() an anytime search: every
+  // shorter solution is reported as soon as it is found and the call returns by the deadline.
+  double deadline = 0;
+};
+
+// Like solve() above. A cancelled search returns "Error: Search cancelled.", one stopped by hooks.deadline before any
+// solution NO_SOLUTION_YET.
+std::string solve(const std::string& cubestring, int max_length, double timeout, const SolveHooks& hooks);
+
+// Solve the cube defined by cubestring to the position defined by goalstring, like kociemba/solver.py: the maneuver
+// transforms the first cube into the second. Errors of the strings are prefixed with "first cube " or "second cube ".
+std::string solveto(const std::string& cubestring, const std::string& goalstring, int max_length = 20,
+                    double timeout = 3, const SolveHooks& hooks = {});
+
+// A pair of solveto_batch(): solve cubes[start] to goals[goal].
+struct SolvetoPair {
+  int start, goal;
+};
+
+// solveto() for many pairs of cubes, e.g. pattern scrambles from many starts to many goals. Every start and goal is
+// checked once and every goal is inverted once, the pairs are solved one after the other on the same pool. result is
+// called in the calling thread with the index of the pair and its result, in the format of solveto(), as soon as it
+// has been solved. hooks apply to the search of every pair.
+void solveto_batch(const std::vector<std::string>& cubes, const std::vector<std::string>& goals,
+                   const std::vector<SolvetoPair>& pairs, int max_length, double timeout,
+                   const std::function<void(size_t, const std::string&)>& result, const SolveHooks& hooks = {});
+
+// Load or create the tables of solve_optimal(). The largest one takes about 650 MB in FOLDER and is created once,
+// which takes a long while. Called by solve_optimal().
+void init_optimal();
+
+// Find a shortest maneuver with IDA*, in the same format as solve(). If the search has not finished after timeout
+// seconds, the result is an error message with the number of moves which have been ruled out. hooks.deadline shortens
+// the timeout if it is earlier. hooks.improved is only called with the final solution, hooks.cache only receives it.
+std::string solve_optimal(const std::string& cubestring, double timeout = 60, const SolveHooks& hooks = {});
+
+}  // namespace twophase
@@ -0,0 +1,280 @@
+#include "symmetries.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace twophase {
+
+namespace {
+
+//  #################### Permutations and orientation changes of the basic symmetries ###################################
+
+// 120° clockwise rotation around the long diagonal URF-DBL
+constexpr CubieCube sym_ROT_URF3 = {{URF, DFR, DLF, UFL, UBR, DRB, DBL, ULB},
+                                    {1, 2, 1, 2, 2, 1, 2, 1},
+                                    {UF, FR, DF, FL, UB, BR, DB, BL, UR, DR, DL, UL},
+                                    {1, 0, 1, 0, 1, 0, 1, 0, 1, 1, 1, 1}};
+// 180° rotation around the axis through the F and B centers
+constexpr CubieCube sym_ROT_F2 = {{DLF, DFR, DRB, DBL, UFL, URF, UBR, ULB},
+                                  {0, 0, 0, 0, 0, 0, 0, 0},
+                                  {DL, DF, DR, DB, UL, UF, UR, UB, FL, FR, BR, BL},
+                                  {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}};
+// 90° clockwise rotation around the axis through the U and D centers
+constexpr CubieCube sym_ROT_U4 = {{UBR, URF, UFL, ULB, DRB, DFR, DLF, DBL},
+                                  {0, 0, 0, 0, 0, 0, 0, 0},
+                                  {UB, UR, UF, UL, DB, DR, DF, DL, BR, FR, FL, BL},
+                                  {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1}};
+// reflection at the plane through the U, D, F, B centers
+constexpr CubieCube sym_MIRR_LR2 = {{UFL, URF, UBR, ULB, DLF, DFR, DRB, DBL},
+                                    {3, 3, 3, 3, 3, 3, 3, 3},
+                                    {UL, UF, UR, UB, DL, DF, DR, DB, FL, FR, BR, BL},
+                                    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}};
+
+constexpr CubieCube basicSymCube[4] = {sym_ROT_URF3, sym_ROT_F2, sym_ROT_U4, sym_MIRR_LR2};
+
+// ######################################## Fill SymCube list ###########################################################
+constexpr std::array<CubieCube, N_SYM> make_sym_cubes() {
+  std::array<CubieCube, N_SYM> ret;
+  CubieCube cc;  // Identity cube
+  int idx = 0;
+  for (int urf3 = 0; urf3 < 3; urf3++) {
+    for (int f2 = 0; f2 < 2; f2++) {
+      for (int u4 = 0; u4 < 4; u4++) {
+        for (int lr2 = 0; lr2 < 2; lr2++) {
+          ret[idx++] = cc;
+          cc.multiply(basicSymCube[MIRR_LR2]);
+        }
+        cc.multiply(basicSymCube[ROT_U4]);
+      }
+      cc.multiply(basicSymCube[ROT_F2]);
+    }
+    cc.multiply(basicSymCube[ROT_URF3]);
+  }
+  return ret;
+}
+
+}  // namespace
+
+constexpr std::array<CubieCube, N_SYM> symCube = make_sym_cubes();
+
+// ########################################## Fill the inv_idx array ####################################################
+constexpr std::array<uint8_t, N_SYM> inv_idx = [] {
+  std::array<uint8_t, N_SYM> ret{};
+  for (int j = 0; j < N_SYM; j++) {
+    for (int i = 0; i < N_SYM; i++) {
+      CubieCube cc = symCube[j];
+      cc.corner_multiply(symCube[i]);
+      if (cc.cp[URF] == URF && cc.cp[UFL] == UFL && cc.cp[ULB] == ULB) {
+        ret[j] = uint8_t(i);
+        break;
+      }
+    }
+  }
+  return ret;
+}();
+
+namespace sy {
+
+std::array<uint8_t, N_SYM * N_SYM> mult_sym;
+
+// #### Generate the table for the conjugation of a move m by a symmetry s. conj_move[N_MOVE*s + m] = s*m*s^-1 ##########
+constexpr std::array<uint8_t, N_MOVE * N_SYM> conj_move = [] {
+  std::array<uint8_t, N_MOVE * N_SYM> ret{};
+  for (int s = 0; s < N_SYM; s++) {
+    for (int m = 0; m < N_MOVE; m++) {
+      CubieCube ss = symCube[s];
+      ss.multiply(moveCube[m]);  // s*m
+      ss.multiply(symCube[inv_idx[s]]);  // s*m*s^-1
+      for (int m2 = 0; m2 < N_MOVE; m2++)
+        if (ss == moveCube[m2]) ret[N_MOVE * s + m] = uint8_t(m2);
+    }
+  }
+  return ret;
+}();
+
+// ################## Generate the table for the conjugation of the twist t by a symmetry s of D4h ######################
+// The corner permutation of t is the identity, so the orientation of corner c of s*t*s^-1 only depends on the
+// orientation of corner cp[c] of s^-1 in t. These 16 * 8 * 3 values are computed with cubie cubes, the table itself
+// with plain arrays which the compiler evaluates much faster.
+constexpr std::array<uint16_t, N_TWIST * N_SYM_D4h> twist_conj = [] {
+  uint8_t from[N_SYM_D4h][8] = {}, ori[N_SYM_D4h][8][3] = {};
+  for (int s = 0; s < N_SYM_D4h; s++) {
+    for (int o = 0; o < 3; o++) {
+      CubieCube cc;
+      cc.co = {uint8_t(o), uint8_t(o), uint8_t(o), uint8_t(o), uint8_t(o), uint8_t(o), uint8_t(o), uint8_t(o)};
+      CubieCube ss = symCube[s];
+      ss.corner_multiply(cc);  // s*t
+      ss.corner_multiply(symCube[inv_idx[s]]);  // s*t*s^-1
+      for (int c = URF; c <= DRB; c++) {
+        from[s][c] = symCube[inv_idx[s]].cp[c];
+        ori[s][c][o] = ss.co[c];
+      }
+    }
+  }
+  std::array<uint16_t, N_TWIST * N_SYM_D4h> ret{};
+  for (int t = 0; t < N_TWIST; t++) {
+    CubieCube cc;
+    cc.set_twist(t);
+    uint8_t co[8] = {};
+    for (int c = URF; c <= DRB; c++) co[c] = cc.co[c];
+    for (int s = 0; s < N_SYM_D4h; s++) {
+      int twist = 0;
+      for (int c = URF; c < DRB; c++) twist = 3 * twist + ori[s][c][co[from[s][c]]];
+      ret[N_SYM_D4h * t + s] = uint16_t(twist);
+    }
+  }
+  return ret;
+}();
+
+Table<uint16_t> ud_edges_conj;
+Table<uint16_t> corners_conj;
+Table<uint16_t> flipslice_classidx;
+Table<uint8_t> flipslice_sym;
+Table<uint32_t> flipslice_rep;
+Table<uint16_t> corner_classidx;
+Table<uint8_t> corner_sym;
+Table<uint16_t> corner_rep;
+
+namespace {
+
+// ################################# Generate the group table for the 48 cube symmetries ################################
+void create_mult_sym() {
+  for (int i = 0; i < N_SYM; i++) {
+    for (int j = 0; j < N_SYM; j++) {
+      CubieCube cc = symCube[i];
+      cc.multiply(symCube[j]);
+      for (int k = 0; k < N_SYM; k++) {
+        if (cc == symCube[k]) {  // symCube[i] * symCube[j] == symCube[k]
+          mult_sym[N_SYM * i + j] = uint8_t(k);
+          break;
+        }
+      }
+    }
+  }
+}
+
+std::vector<uint16_t> create_ud_edges_conj() {
+  std::vector<uint16_t> table(N_UD_EDGES * N_SYM_D4h);
+  for (int t = 0; t < N_UD_EDGES; t++) {
+    CubieCube cc;
+    cc.set_ud_edges(t);
+    for (int s = 0; s < N_SYM_D4h; s++) {
+      CubieCube ss = symCube[s];
+      ss.edge_multiply(cc);  // s*t
+      ss.edge_multiply(symCube[inv_idx[s]]);  // s*t*s^-1
+      table[N_SYM_D4h * t + s] = uint16_t(ss.get_ud_edges());
+    }
+  }
+  return table;
+}
+
+std::vector<uint16_t> create_corners_conj() {
+  std::vector<uint16_t> table(N_CORNERS * N_SYM_D4h);
+  for (int t = 0; t < N_CORNERS; t++) {
+    CubieCube cc;
+    cc.set_corners(t);
+    for (int s = 0; s < N_SYM_D4h; s++) {
+      CubieCube ss = symCube[s];
+      ss.corner_multiply(cc);  // s*t
+      ss.corner_multiply(symCube[inv_idx[s]]);  // s*t*s^-1
+      table[N_SYM_D4h * t + s] = uint16_t(ss.get_corners());
+    }
+  }
+  return table;
+}
+
+// The three tables of a symmetry reduced coordinate: idx -> classidx, idx -> symmetry and classidx -> representant.
+template <typename Rep>
+struct SymTables {
+  std::vector<uint16_t> classidx;
+  std::vector<uint8_t> sym;
+  std::vector<Rep> rep;
+};
+
+SymTables<uint32_t> create_flipslice_tables() {
+  SymTables<uint32_t> t{std::vector<uint16_t>(N_FLIP * N_SLICE, INVALID), std::vector<uint8_t>(N_FLIP * N_SLICE, 0),
+                        std::vector<uint32_t>(N_FLIPSLICE_CLASS, 0)};
+  int classidx = 0;
+  CubieCube cc;
+  for (int slc = 0; slc < N_SLICE; slc++) {
+    cc.set_slice(slc);
+    for (int flip = 0; flip < N_FLIP; flip++) {
+      cc.set_flip(flip);
+      int idx = N_FLIP * slc + flip;
+      if (t.classidx[idx] != INVALID) continue;
+      t.classidx[idx] = uint16_t(classidx);
+      t.sym[idx] = 0;
+      t.rep[classidx] = uint32_t(idx);
+      for (int s = 0; s < N_SYM_D4h; s++) {  // conjugate representant by all 16 symmetries
+        CubieCube ss = symCube[inv_idx[s]];
+        ss.edge_multiply(cc);
+        ss.edge_multiply(symCube[s]);  // s^-1*cc*s
+        int idx_new = N_FLIP * ss.get_slice() + ss.get_flip();
+        if (t.classidx[idx_new] == INVALID) {
+          t.classidx[idx_new] = uint16_t(classidx);
+          t.sym[idx_new] = uint8_t(s);
+        }
+      }
+      classidx++;
+    }
+  }
+  return t;
+}
+
+SymTables<uint16_t> create_corner_tables() {
+  SymTables<uint16_t> t{std::vector<uint16_t>(N_CORNERS, INVALID), std::vector<uint8_t>(N_CORNERS, 0),
+                        std::vector<uint16_t>(N_CORNERS_CLASS, 0)};
+  int classidx = 0;
+  CubieCube cc;
+  for (int cp = 0; cp < N_CORNERS; cp++) {
+    cc.set_corners(cp);
+    if (t.classidx[cp] != INVALID) continue;
+    t.classidx[cp] = uint16_t(classidx);
+    t.sym[cp] = 0;
+    t.rep[classidx] = uint16_t(cp);
+    for (int s = 0; s < N_SYM_D4h; s++) {  // conjugate representant by all 16 symmetries
+      CubieCube ss = symCube[inv_idx[s]];
+      ss.corner_multiply(cc);
+      ss.corner_multiply(symCube[s]);  // s^-1*cc*s
+      int cp_new = ss.get_corners();
+      if (t.classidx[cp_new] == INVALID) {
+        t.classidx[cp_new] = uint16_t(classidx);
+        t.sym[cp_new] = uint8_t(s);
+      }
+    }
+    classidx++;
+  }
+  return t;
+}
+
+// Load the three tables of a symmetry reduced coordinate, a missing table creates all of them once.
+template <typename Rep, typename Create>
+void load_sym_tables(const char* prefix, size_t n, size_t n_class, Table<uint16_t>& classidx, Table<uint8_t>& sym,
+                     Table<Rep>& rep, Create create) {
+  std::optional<SymTables<Rep>> created;
+  auto get = [&]() -> SymTables<Rep>& {
+    if (!created) created = create();
+    return *created;
+  };
+  const std::string p = prefix;
+  classidx = load_or_create<uint16_t>(p + "_classidx", n, [&] { return get().classidx; });
+  sym = load_or_create<uint8_t>(p + "_sym", n, [&] { return get().sym; });
+  rep = load_or_create<Rep>(p + "_rep", n_class, [&] { return get().rep; });
+}
+
+}  // namespace
+
+void init() {
+  create_mult_sym();
+  ud_edges_conj = load_or_create<uint16_t>("conj_ud_edges", N_UD_EDGES * N_SYM_D4h, create_ud_edges_conj);
+  corners_conj = load_or_create<uint16_t>("conj_corners", N_CORNERS * N_SYM_D4h, create_corners_conj);
+
+  load_sym_tables("fs", N_FLIP * N_SLICE, N_FLIPSLICE_CLASS, flipslice_classidx, flipslice_sym, flipslice_rep,
+                  create_flipslice_tables);
+  load_sym_tables("co", N_CORNERS, N_CORNERS_CLASS, corner_classidx, corner_sym, corner_rep, create_corner_tables);
+}
+
+}  // namespace sy
+
+}  // namespace twophase
@@ -0,0 +1,50 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+#include "cubie.hpp"
+#include "tables.hpp"
+
+// #################### Symmetry related functions. Symmetry considerations increase the performance of the solver.######
+// Mirrors kociemba/symmetries.py.
+
+namespace twophase {
+
+// 48 CubieCubes will represent the 48 cube symmetries
+extern const std::array<CubieCube, N_SYM> symCube;
+// Indices for the inverse symmetries: symCube[inv_idx[idx]] == symCube[idx]^(-1)
+extern const std::array<uint8_t, N_SYM> inv_idx;
+
+namespace sy {
+
+inline constexpr uint16_t INVALID = 65535;
+
+// Group table for the 48 cube symmetries, symCube[i] * symCube[j] == symCube[mult_sym[N_SYM * i + j]]
+extern std::array<uint8_t, N_SYM * N_SYM> mult_sym;  // filled by init()
+// Conjugation of a move m by a symmetry s. conj_move[N_MOVE * s + m] = s * m * s^-1
+extern const std::array<uint8_t, N_MOVE * N_SYM> conj_move;
+
+// Conjugation of the twist t by a symmetry s of D4h. twist_conj[16 * t + s] = s * t * s^-1
+extern const std::array<uint16_t, N_TWIST * N_SYM_D4h> twist_conj;
+// Conjugation of the ud_edges coordinate t by a symmetry s of D4h. ud_edges_conj[16 * t + s] = s * t * s^-1
+extern Table<uint16_t> ud_edges_conj;
+// Conjugation of the corners coordinate t by a symmetry s of D4h. corners_conj[16 * t + s] = s * t * s^-1
+// Only used by the optimal solver.
+extern Table<uint16_t> corners_conj;
+
+// Symmetry reduced flip-slice coordinate used in phase 1
+extern Table<uint16_t> flipslice_classidx;  // idx -> classidx
+extern Table<uint8_t> flipslice_sym;  // idx -> symmetry
+extern Table<uint32_t> flipslice_rep;  // classidx -> idx of representant
+
+// Symmetry reduced corner permutation coordinate used in phase 2
+extern Table<uint16_t> corner_classidx;  // idx -> classidx
+extern Table<uint8_t> corner_sym;  // idx -> symmetry
+extern Table<uint16_t> corner_rep;  // classidx -> idx of representant
+
+// Fill mult_sym, load the Table members from FOLDER or create them. The std::array tables are compile time constants.
+void init();
+
+}  // namespace sy
+
+}  // namespace twophase
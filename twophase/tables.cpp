@@ -0,0 +1,134 @@
+#include "tables.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "defs.hpp"
+
+namespace twophase {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+struct TableHeader {
+  char magic[8];  // "TWOPHASE"
+  uint32_t version;  // TABLE_VERSION
+  uint32_t elem_size;
+  uint64_t count;
+  int64_t mtime_ns;  // modification time of the data file when the checksum was last verified
+  uint64_t checksum;  // checksum() of the data file
+};
+
+constexpr char MAGIC[8] = {'T', 'W', 'O', 'P', 'H', 'A', 'S', 'E'};
+
+// 64 bit multiply-xor hash over the data, word by word.
+uint64_t checksum(const void* data, size_t len) {
+  const auto* p = static_cast<const unsigned char*>(data);
+  uint64_t h = 0xcbf29ce484222325ull ^ len;
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    uint64_t w;
+    std::memcpy(&w, p + i, 8);
+    h = (h ^ w) * 0x100000001b3ull;
+    h ^= h >> 29;
+  }
+  for (; i < len; i++) h = (h ^ p[i]) * 0x100000001b3ull;
+  return h;
+}
+
+fs::path data_path(const std::string& fname) { return fs::path(FOLDER) / fname; }
+fs::path header_path(const std::string& fname) { return fs::path(FOLDER) / (fname + ".hdr"); }
+
+int64_t mtime_ns(const struct stat& st) { return int64_t(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec; }
+
+bool read_header(const std::string& fname, TableHeader& hdr) {
+  std::ifstream in(header_path(fname), std::ios::binary);
+  return in.read(reinterpret_cast<char*>(&hdr), sizeof(hdr)) && std::memcmp(hdr.magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+bool write_header(const std::string& fname, const TableHeader& hdr) {
+  const fs::path tmp = header_path(fname).string() + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary);
+    if (!out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr))) return false;
+  }
+  std::error_code ec;
+  fs::rename(tmp, header_path(fname), ec);
+  return !ec;
+}
+
+}  // namespace
+
+std::shared_ptr<const void> map_table(const std::string& fname, size_t elem_size, size_t count) {
+  const size_t len = elem_size * count;
+  int fd = ::open(data_path(fname).c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return nullptr;
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || size_t(st.st_size) != len) {
+    ::close(fd);
+    return nullptr;
+  }
+  void* addr = ::mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);  // the mapping keeps the file referenced
+  if (addr == MAP_FAILED) return nullptr;
+  std::shared_ptr<const void> mapped(addr, [len](const void* p) { ::munmap(const_cast<void*>(p), len); });
+
+  TableHeader hdr;
+  bool has_header = read_header(fname, hdr);
+  if (has_header && (hdr.version != TABLE_VERSION || hdr.elem_size != elem_size || hdr.count != count))
+    return nullptr;  // stale table, create it again
+  if (has_header && hdr.mtime_ns == mtime_ns(st)) return mapped;  // unchanged since the last verification
+
+  // New or modified data file, e.g. created by kociemba/: verify it against the header or create the header.
+  uint64_t sum = checksum(addr, len);
+  if (has_header && hdr.checksum != sum) {
+    std::cerr << "checksum mismatch in table " << fname << std::endl;
+    return nullptr;
+  }
+  std::memcpy(hdr.magic, MAGIC, sizeof(MAGIC));
+  hdr.version = TABLE_VERSION;
+  hdr.elem_size = uint32_t(elem_size);
+  hdr.count = count;
+  hdr.mtime_ns = mtime_ns(st);
+  hdr.checksum = sum;
+  write_header(fname, hdr);  // best effort, a read-only FOLDER only costs the checksum on every start
+  return mapped;
+}
+
+bool store_table(const std::string& fname, const void* data, size_t elem_size, size_t count) {
+  std::error_code ec;
+  fs::create_directories(FOLDER, ec);
+  const fs::path tmp = data_path(fname).string() + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary);
+    if (!out.write(static_cast<const char*>(data), std::streamsize(elem_size * count))) {
+      std::cerr << "could not store " << data_path(fname) << std::endl;
+      return false;
+    }
+  }
+  fs::rename(tmp, data_path(fname), ec);  // readers never see a partially written table
+  if (ec) return false;
+  struct stat st;
+  if (::stat(data_path(fname).c_str(), &st) != 0) return false;
+  TableHeader hdr;
+  std::memcpy(hdr.magic, MAGIC, sizeof(MAGIC));
+  hdr.version = TABLE_VERSION;
+  hdr.elem_size = uint32_t(elem_size);
+  hdr.count = count;
+  hdr.mtime_ns = mtime_ns(st);
+  hdr.checksum = checksum(data, elem_size * count);
+  return write_header(fname, hdr);
+}
+
+void log_create(const std::string& fname) { std::cerr << "creating " << fname << " table..." << std::endl; }
+
+}  // namespace twophase
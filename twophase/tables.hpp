@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Loading and storing of the precomputed tables. The data files have the same raw layout as the ones written by
+// array.tofile() in kociemba/, so both implementations share the FOLDER directory. Each data file gets a small header
+// file <name>.hdr next to it with a version, the table shape and a checksum. Valid tables are memory mapped read-only
+// and used in place, so loading them costs only page faults.
+
+namespace twophase {
+
+// Bump if the content of a table changes, stale tables are then created again.
+inline constexpr uint32_t TABLE_VERSION = 1;
+
+// Read-only view of a precomputed table, backed by a memory mapped file or by memory owned by the table.
+template <typename T>
+class Table {
+public:
+  Table() = default;
+  Table(std::shared_ptr<const void> storage, size_t size)
+      : storage_(std::move(storage)), data_(static_cast<const T*>(storage_.get())), size_(size) {}
+
+  const T& operator[](size_t i) const { return data_[i]; }
+  const T* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+private:
+  std::shared_ptr<const void> storage_;
+  const T* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// Map the table fname with count entries of elem_size bytes from FOLDER. Returns nullptr if the file is missing or
+// does not pass the header and checksum validation.
+std::shared_ptr<const void> map_table(const std::string& fname, size_t elem_size, size_t count);
+// Store the table fname together with its header in FOLDER. Returns false if the file could not be written.
+bool store_table(const std::string& fname, const void* data, size_t elem_size, size_t count);
+// Report the creation of a table, creating the large tables takes a while.
+void log_create(const std::string& fname);
+
+// Load table fname with n entries from FOLDER or create it with create() and store it if the file is not valid.
+template <typename T, typename Create>
+Table<T> load_or_create(const std::string& fname, size_t n, Create create) {
+  if (auto mapped = map_table(fname, sizeof(T), n)) return Table<T>(std::move(mapped), n);
+  log_create(fname);
+  std::vector<T> table = create();
+  if (store_table(fname, table.data(), sizeof(T), n))
+    if (auto mapped = map_table(fname, sizeof(T), n)) return Table<T>(std::move(mapped), n);
+  auto owned = std::make_shared<const std::vector<T>>(std::move(table));  // could not be stored, keep it in memory
+  return Table<T>(std::shared_ptr<const void>(owned, owned->data()), n);
+}
+
+}  // namespace twophase
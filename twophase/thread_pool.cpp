@@ -0,0 +1,102 @@
+#include "thread_pool.hpp"
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace twophase {
+
+ThreadPool::ThreadPool(int threads, int nice) {
+  if (threads < 1) threads = 1;
+  for (int i = 0; i < threads; i++) queues.push_back(std::make_unique<Queue>());
+  for (int i = 0; i < threads; i++) workers.emplace_back(&ThreadPool::worker, this, i, nice);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard guard(idle_lock);
+    stopping = true;
+  }
+  idle.notify_all();
+  for (auto& t : workers) t.join();
+}
+
+void ThreadPool::run(std::vector<Task> tasks) {
+  if (tasks.empty()) return;
+  auto batch = std::make_shared<Batch>();
+  batch->pending = int(tasks.size());
+  const int n = size();
+  unsigned q = next_queue.fetch_add(unsigned(tasks.size()));
+  for (auto& task : tasks) {
+    Queue& queue = *queues[q++ % n];
+    std::lock_guard guard(queue.lock);
+    queue.items.push_back({std::move(task), batch});
+  }
+  {
+    std::lock_guard guard(idle_lock);
+    queued += int(tasks.size());
+  }
+  idle.notify_all();
+
+  // help with the own tasks until the batch is done, then wait for the tasks still running on the workers. A task of
+  // another caller could run for long and hold up this one, e.g. past the deadline of its solve.
+  Item item;
+  while (batch->pending.load() > 0 && pop(-1, item, batch.get())) execute(item);
+  std::unique_lock lock(batch->lock);
+  batch->finished.wait(lock, [&] { return batch->pending.load() == 0; });
+}
+
+bool ThreadPool::pop(int self, Item& item, const Batch* only) {
+  const int n = size();
+  if (self >= 0) {
+    Queue& own = *queues[self];
+    std::lock_guard guard(own.lock);
+    if (!own.items.empty()) {
+      item = std::move(own.items.back());
+      own.items.pop_back();
+      queued--;
+      return true;
+    }
+  }
+  for (int i = 1; i <= n; i++) {
+    Queue& victim = *queues[(self + i + n) % n];
+    std::lock_guard guard(victim.lock);
+    auto it = only ? std::find_if(victim.items.begin(), victim.items.end(),
+                                  [only](const Item& x) { return x.batch.get() == only; })
+                   : victim.items.begin();
+    if (it != victim.items.end()) {
+      item = std::move(*it);
+      victim.items.erase(it);
+      queued--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::execute(Item& item) {
+  item.task();
+  std::shared_ptr<Batch> batch = std::move(item.batch);
+  item.task = nullptr;
+  if (batch->pending.fetch_sub(1) == 1) {
+    std::lock_guard guard(batch->lock);
+    batch->finished.notify_all();
+  }
+}
+
+void ThreadPool::worker(int self, int nice) {
+  if (nice != 0) ::setpriority(PRIO_PROCESS, ::gettid(), nice);  // Linux: the nice value of this thread only
+  Item item;
+  for (;;) {
+    if (pop(self, item)) {
+      execute(item);
+      continue;
+    }
+    std::unique_lock lock(idle_lock);
+    idle.wait(lock, [&] { return stopping || queued.load() > 0; });
+    if (stopping) return;
+  }
+}
+
+}  // namespace twophase
@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool used by the solver. Every worker has its own task deque, it pops its own tasks from the
+// back and steals from the front of the other deques when it runs dry. Several callers may run() task batches at the
+// same time, a caller helps executing the tasks of its own batch until it is finished.
+
+namespace twophase {
+
+class ThreadPool {
+public:
+  using Task = std::function<void()>;
+
+  // The workers lower their scheduling priority by nice, 0 keeps the priority of the process.
+  explicit ThreadPool(int threads = int(std::thread::hardware_concurrency()), int nice = 0);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  int size() const { return int(workers.size()); }
+  // Execute all tasks and return when they have finished. The tasks are spread round-robin over the workers.
+  void run(std::vector<Task> tasks);
+
+private:
+  struct Batch {
+    std::atomic<int> pending;
+    std::mutex lock;
+    std::condition_variable finished;
+  };
+  struct Item {
+    Task task;
+    std::shared_ptr<Batch> batch;
+  };
+  struct Queue {
+    std::mutex lock;
+    std::deque<Item> items;
+  };
+
+  // Own deque first, then steal, self == -1 only steals. With only set, only the tasks of that batch are stolen.
+  bool pop(int self, Item& item, const Batch* only = nullptr);
+  void execute(Item& item);
+  void worker(int self, int nice);
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+  std::mutex idle_lock;
+  std::condition_variable idle;
+  std::atomic<int> queued = 0;  // number of tasks in all deques
+  std::atomic<unsigned> next_queue = 0;
+  bool stopping = false;  // guarded by idle_lock
+};
+
+// The pool of the searches of solve() and solve_optimal(), see set_threads().
+ThreadPool& search_pool();
+
+}  // namespace twophase
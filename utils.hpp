@@ -1,13 +1,245 @@
 #pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
 #include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
 #include <cpr/cpr.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 
-void updCubeString(const char& move) {
-  cpr::Response RR = cpr::Get(cpr::Url{"http://localhost:8081/move"},
-                      cpr::Parameters{{"move", std::string(1, move)}});
+#include "cube_state.hpp"
+#include "server/protocol.hpp"
+#include "twophase/solver.hpp"
+
+// Reports the moves to the backend from a background thread, so a slow backend never blocks the GLUT thread. The
+// GLUT callbacks push into a single producer single consumer ring, the sender sends everything that piled up since
+// its last request as one /move request over a persistent connection. Every client reports under its own random
+// session id, so clients sharing a backend do not move each other's cubes. If cube-server listens on its Unix socket
+// the moves go there instead, one byte per move and no reply to wait for, see server/protocol.hpp.
+class MoveReporter {
+public:
+  MoveReporter() : sessionId(newSessionId()), sender(&MoveReporter::run, this) {}
+  ~MoveReporter() {
+    while (!flush()) std::this_thread::sleep_for(std::chrono::milliseconds(1));  // the sender frees the ring
+    stopping = true;
+    wakeups++;
+    wakeups.notify_one();
+    sender.join();  // the remaining moves are still sent
+  }
+
+  // Called from the GLUT thread only, never blocks. Moves which do not fit into the ring wait in overflow until the
+  // next push() or flush().
+  void push(char move) {
+    overflow += move;
+    flush();
+  }
+
+  // Move what fits of overflow into the ring, called from the GLUT thread only. Returns false if moves are left, the
+  // caller tries again later.
+  bool flush() {
+    size_t h = head.load(std::memory_order_relaxed), t = tail.load(std::memory_order_acquire);
+    size_t n = 0;
+    for (; n < overflow.size() && h - t < CAPACITY; n++) ring[h++ % CAPACITY] = overflow[n];
+    overflow.erase(0, n);
+    head.store(h, std::memory_order_release);
+    if (n > 0) {
+      wakeups++;
+      wakeups.notify_one();
+    }
+    return overflow.empty();
+  }
+
+private:
+  static constexpr size_t CAPACITY = 1024;
+
+  static std::string newSessionId() {
+    std::random_device rd;
+    char id[17];
+    std::snprintf(id, sizeof(id), "%08x%08x", unsigned(rd()), unsigned(rd()));
+    return id;
+  }
+
+  // Connection to the Unix socket of cube-server, -1 if there is none and HTTP is used.
+  int connectLocal() {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", proto::DEFAULT_PATH);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+        sendLocal(fd, proto::session_request(sessionId)))
+      return fd;
+    if (fd >= 0) close(fd);
+    return -1;
+  }
+
+  static bool sendLocal(int fd, const std::string& data) {
+    for (size_t pos = 0; pos < data.size();) {
+      ssize_t n = send(fd, data.data() + pos, data.size() - pos, MSG_NOSIGNAL);
+      if (n <= 0) return false;
+      pos += size_t(n);
+    }
+    return true;
+  }
+
+  // The quarter turns u r f d l b as twophase::Move bytes.
+  static std::string localMoves(const std::string& batch) {
+    static const std::string faces = "urfdlb";
+    std::string moves;
+    for (char ch : batch) moves += char(3 * faces.find(ch));
+    return moves;
+  }
+
+  void run() {
+    int local = connectLocal();
+    cpr::Session session;
+    session.SetUrl(cpr::Url{"http://localhost:8081/move"});
+    session.SetTimeout(cpr::Timeout{1000});
+    std::string batch;
+    while (true) {
+      unsigned seen = wakeups.load();
+      size_t t = tail.load(std::memory_order_relaxed), h = head.load(std::memory_order_acquire);
+      for (; t != h; t++) batch += ring[t % CAPACITY];
+      tail.store(t, std::memory_order_release);
+      if (!batch.empty() && local >= 0) {
+        if (sendLocal(local, localMoves(batch))) {
+          batch.clear();
+          continue;
+        }
+        std::cerr << "Reporting moves over " << proto::DEFAULT_PATH << " failed, falling back to HTTP\n";
+        close(local);
+        local = -1;
+      }
+      if (!batch.empty()) {
+        session.SetParameters(cpr::Parameters{{"session", sessionId}, {"move", batch}});
+        cpr::Response RR = session.Get();
+        if (RR.error) std::cerr << "Reporting moves " << batch << " failed: " << RR.error.message << "\n";
+        batch.clear();
+        continue;
+      }
+      if (stopping) break;
+      wakeups.wait(seen);
+    }
+    if (local >= 0) close(local);
+  }
+
+  const std::string sessionId;
+  std::array<char, CAPACITY> ring;
+  std::atomic<size_t> head = 0, tail = 0;  // written by push() and by the sender
+  std::atomic<unsigned> wakeups = 0;  // the sender sleeps until this changes
+  std::atomic<bool> stopping = false;
+  std::string overflow;  // GLUT thread only
+  std::thread sender;
+};
+
+MoveReporter moveReporter;
+
+void updCubeString(const char& move) { moveReporter.push(move); }
+
+// Target length and timeout of the solves of the client. The first solution has 20 moves or more for most cubes, so
+// the search goes on and reports every shorter one until it reaches the target or the timeout.
+constexpr int SOLVE_MAX_LENGTH = 18;
+constexpr double SOLVE_TIMEOUT = 3;
+
+// Runs the native solver on the cube instead of asking the backend.
+std::string solveCube(const CubeState& cube, const twophase::SolveHooks& hooks = {}) {
+  return twophase::solve(cube.to_string(), SOLVE_MAX_LENGTH, SOLVE_TIMEOUT, hooks);
 }
 
-std::string solveCube() {
-  cpr::Response RR = cpr::Get(cpr::Url{"http://localhost:8081/solve"});
-  return RR.text;
-}
\ No newline at end of file
+// Runs solveCube() on a worker thread. The GLUT thread starts and cancels searches and polls status() every frame,
+// it never waits for a search or for the tables.
+class BackgroundSolver {
+public:
+  struct Status {
+    bool active = false;  // a search has been started and not been cancelled
+    bool running = false;
+    std::string best;  // best solution so far, the final result once running is false
+    double elapsed = 0;  // seconds since the start, frozen when the search has finished
+  };
+
+  ~BackgroundSolver() {
+    cancel();
+    if (tables.joinable()) tables.join();
+    for (Worker& w : workers) w.thread.join();
+  }
+
+  // Load or create the tables on a thread of their own, so that the first search does not wait for them. Creating
+  // them takes a while if precomputed/ is empty, a search started meanwhile waits inside twophase::init().
+  void prepare() {
+    tables = std::thread([] { twophase::init(); });
+  }
+
+  // Start a search for cube, a running search is cancelled. Its thread is joined by a later start() once it has
+  // finished, it may still wait for the tables and cannot see the cancellation before.
+  void start(const CubeState& cube) {
+    cancel();
+    std::erase_if(workers, [](Worker& w) {
+      if (!w.job->done) return false;
+      w.thread.join();  // the thread has finished or is about to
+      return true;
+    });
+    job = std::make_shared<Job>();
+    std::thread worker([job = job, cube] {
+      twophase::SolveHooks hooks;
+      hooks.cancel = &job->cancelled;
+      hooks.improved = [&job](const std::string& s) { job->set(s, true); };
+      std::string s = solveCube(cube, hooks);
+      if (!job->cancelled) job->set(s, false);
+      job->done = true;
+    });
+    workers.push_back({std::move(worker), job});
+  }
+
+  // Stop the current search and forget its result, e.g. because the cube has been moved.
+  void cancel() {
+    if (job) job->cancelled = true;
+    job.reset();
+  }
+
+  Status status() const {
+    Status st;
+    if (!job) return st;
+    std::lock_guard guard(job->lock);
+    st.active = true;
+    st.running = job->running;
+    st.best = job->best;
+    auto end = job->running ? std::chrono::steady_clock::now() : job->finished;
+    st.elapsed = std::chrono::duration<double>(end - job->start).count();
+    return st;
+  }
+
+private:
+  struct Job {
+    std::atomic<bool> cancelled = false;
+    std::atomic<bool> done = false;  // the worker has nothing left to do
+    std::mutex lock;  // guards the members below
+    bool running = true;
+    std::string best;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now(), finished;
+
+    void set(const std::string& s, bool still_running) {
+      std::lock_guard guard(lock);
+      best = s;
+      running = still_running;
+      if (!running) finished = std::chrono::steady_clock::now();
+    }
+  };
+
+  struct Worker {
+    std::thread thread;
+    std::shared_ptr<Job> job;
+  };
+
+  std::shared_ptr<Job> job;  // GLUT thread only, the worker holds its own reference
+  std::vector<Worker> workers;  // the current one and the cancelled ones which have not been joined yet
+  std::thread tables;
+};
+
+BackgroundSolver backgroundSolver;